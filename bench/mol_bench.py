@@ -0,0 +1,289 @@
+"""Mollang benchmark suite and regression harness.
+
+Generates a corpus of representative .mol workloads, then measures for each one:
+  - compile-phase throughput (tokens/s, AST nodes/s) and translation time from --stats=json,
+  - g++ time for the generated C++,
+  - runtime of the native executable, the bytecode VM (--run) and interpreter.py.
+
+Results are compared with a stored baseline, and any metric that got worse by more than the
+threshold is reported as a regression (exit status 1).
+
+    python3 bench/mol_bench.py                      # run and compare with bench/baseline.json
+    python3 bench/mol_bench.py --save-baseline      # run and store the results as the baseline
+    python3 bench/mol_bench.py --scale 0.1 --no-python   # quick smoke run
+
+interpreter.py is much slower than the other backends, so it runs each workload at
+1/--python-divisor of the size and its time is extrapolated to the full size.
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import subprocess
+import sys
+import time
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+# --- Workloads ---
+# Each generator returns (source, stdin_text) for a problem size n.
+
+def counter_loop(n):
+    return ("밥 은 0\n바압 은 0\n"
+            f"몰 밥 작 {n} [\n\t바압 은 바압 더하기 3\n\t밥 은 밥 더하기 1\n]\n"
+            "스크럼 바압\n"), ""
+
+
+def string_building(n):
+    # The folded literals check that backslashes stay literal text: the native and VM outputs
+    # must both end in \x41 and a\b.
+    return ("밥 은 \"mol\"\n바압 은 0\n"
+            f"몰 바압 작 {n} [\n\t밥 은 밥 더하기 \"lang\"\n\t바압 은 바압 더하기 1\n]\n"
+            "스크럼 밥\n"
+            "스크럼 \"\\x4\" 합 \"1\"\n"
+            "스크럼 \"a\\\" 합 \"b\"\n"), ""
+
+
+def print_heavy(n):
+    return ("밥 은 0\n"
+            f"몰 밥 작 {n} [\n\t스크럼 밥\n\t스크럼 클로드\n\t밥 은 밥 더하기 1\n]\n"), ""
+
+
+def input_heavy(n):
+    source = ("밥 은 0\n바압 은 0\n"
+              f"몰 밥 작 {n} [\n\t바아압 은 뭐먹\n\t바압 은 바압 더하기 바아압\n\t밥 은 밥 더하기 1\n]\n"
+              "스크럼 바압\n")
+    return source, "".join(f"{i % 1000}\n" for i in range(n))
+
+
+def deep_nesting(n, depth=24):
+    lines = ["밥 은 0", "바압 은 0", f"몰 밥 작 {n} ["]
+    for level in range(depth):
+        indent = "\t" * (level + 1)
+        lines.append(f"{indent}입 밥 작 {n + level} [")
+    lines.append("\t" * (depth + 1) + "바압 은 바압 더하기 1")
+    for level in reversed(range(depth)):
+        lines.append("\t" * (level + 1) + "]")
+    lines += ["\t밥 은 밥 더하기 1", "]", "스크럼 바압"]
+    return "\n".join(lines) + "\n", ""
+
+
+def many_functions(n, count=64):
+    # Even functions are small enough to be inlined, odd ones stay real calls.
+    names = ["캠프" + "프" * i for i in range(count)]
+    lines = ["바압 은 0"]
+    for i, name in enumerate(names):
+        lines.append(f"{name} [")
+        for _ in range(1 if i % 2 == 0 else 12):
+            lines.append(f"\t바압 은 바압 더하기 {i % 7 + 1}")
+        lines.append("]")
+    lines += ["밥 은 0", f"몰 밥 작 {n} ["]
+    lines += [f"\t{name}" for name in names]
+    lines += ["\t밥 은 밥 더하기 1", "]", "스크럼 바압"]
+    return "\n".join(lines) + "\n", ""
+
+
+def large_source(n):
+    # n KB of straight-line code; it runs in no time, so it measures the front end.
+    block = ("바압 은 바압 더하기 7\n"
+             "입 바압 작 100 [\n\t바아압 은 바아압 더하기 \"x\"\n]\n"
+             "바아아압 은 바압 곱 2\n")
+    lines = ["바압 은 0", "바아압 은 \"\"", "바아아압 은 0"]
+    size = 0
+    while size < n * 1024:
+        lines.append(block)
+        size += len(block.encode("utf-8"))
+    lines.append("스크럼 바압")
+    return "\n".join(lines) + "\n", ""
+
+
+# name: (generator, size at --scale 1, run natively, run in interpreter.py)
+WORKLOADS = {
+    "counter_loop": (counter_loop, 20_000_000, True, True),
+    "string_building": (string_building, 2_000_000, True, True),
+    "print_heavy": (print_heavy, 1_000_000, True, True),
+    "input_heavy": (input_heavy, 1_000_000, True, True),
+    "deep_nesting": (deep_nesting, 2_000_000, True, True),
+    "many_functions": (many_functions, 100_000, True, True),
+    "large_source": (large_source, 4096, False, False),
+}
+
+# Metrics where a larger value is better; everything else is a time.
+HIGHER_IS_BETTER = {"tokens_per_s", "nodes_per_s"}
+IN_PROCESS_PHASES = {"tokenize", "parse", "optimize", "collect_symbols", "infer_types", "analyze_loops",
+                     "generate", "bytecode"}
+
+
+# --- Measurement ---
+
+def build_compiler(work_dir):
+    compiler = os.path.join(work_dir, "compiler")
+    sources = [os.path.join(REPO_ROOT, name) for name in ("compiler.cpp", "mollang_runtime.cpp")]
+    subprocess.run(["g++", "-std=c++17", "-O2", "-pthread", "-o", compiler] + sources, check=True)
+    return compiler
+
+
+def run_timed(command, stdin_path, timeout=None):
+    """Runs a command with stdout discarded; returns (seconds, stdout hash, stderr)."""
+    with open(stdin_path, "rb") as stdin:
+        start = time.perf_counter()
+        result = subprocess.run(command, stdin=stdin, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                timeout=timeout)
+        elapsed = time.perf_counter() - start
+    if result.returncode != 0:
+        raise RuntimeError(f"{' '.join(command)} failed:\n{result.stderr.decode(errors='replace')}")
+    return elapsed, hashlib.sha1(result.stdout).hexdigest(), result.stderr.decode(errors="replace")
+
+
+def best_of(repeat, command, stdin_path):
+    runs = [run_timed(command, stdin_path) for _ in range(repeat)]
+    return min(run[0] for run in runs), runs[0][1]
+
+
+def parse_stats(stderr):
+    for line in reversed(stderr.splitlines()):
+        if line.startswith("{\"phases\""):
+            return json.loads(line)
+    raise RuntimeError("no --stats=json output:\n" + stderr)
+
+
+def front_end_metrics(stats):
+    phases = {phase["name"]: phase["ms"] for phase in stats["phases"]}
+    metrics = {"translate_ms": sum(ms for name, ms in phases.items() if name in IN_PROCESS_PHASES)}
+    # Newer compilers tokenize while parsing and report both as "parse".
+    front_ms = phases.get("tokenize", 0) + phases.get("parse", 0)
+    if front_ms:
+        metrics["tokens_per_s"] = stats["tokens"] / (front_ms / 1000)
+        metrics["nodes_per_s"] = stats["ast_nodes"] / (front_ms / 1000)
+    return metrics, phases
+
+
+def write_workload(work_dir, name, source, stdin_text):
+    path = os.path.join(work_dir, name + ".mol")
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(source)
+    stdin_path = os.path.join(work_dir, name + ".in")
+    with open(stdin_path, "w", encoding="utf-8") as f:
+        f.write(stdin_text)
+    return path, stdin_path
+
+
+def measure(name, args, compiler, work_dir, env):
+    generator, size, native, python = WORKLOADS[name]
+    n = max(1, int(size * args.scale))
+    path, stdin_path = write_workload(work_dir, name, *generator(n))
+    metrics = {}
+
+    # The VM run also reports the front-end phases without involving g++.
+    _, _, stderr = run_timed([compiler, "--run", "--stats=json", path], stdin_path)
+    front_end, _ = front_end_metrics(parse_stats(stderr))
+    metrics.update(front_end)
+    metrics["vm_ms"], vm_hash = best_of(args.repeat, [compiler, "--run", path], stdin_path)
+    metrics["vm_ms"] *= 1000
+
+    if native:
+        result = subprocess.run([compiler, "--no-cache", "--stats=json", "--build=" + args.build, path], env=env,
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        if result.returncode != 0:
+            raise RuntimeError(f"compiling {name} failed:\n{result.stderr.decode(errors='replace')}")
+        _, phases = front_end_metrics(parse_stats(result.stderr.decode(errors="replace")))
+        metrics["gxx_ms"] = phases["g++"]
+        exe = path[:-len(".mol")]
+        metrics["native_ms"], native_hash = best_of(args.repeat, [exe], stdin_path)
+        metrics["native_ms"] *= 1000
+        if native_hash != vm_hash:
+            print(f"  경고: {name}의 네이티브 출력이 VM 출력과 다릅니다", file=sys.stderr)
+
+    if python and not args.no_python:
+        small = max(1, n // args.python_divisor)
+        small_path, small_stdin = write_workload(work_dir, name + "_py", *generator(small))
+        try:
+            seconds, _, _ = run_timed([sys.executable, os.path.join(REPO_ROOT, "interpreter.py"), small_path],
+                                      small_stdin, timeout=args.python_timeout)
+            metrics["python_ms"] = seconds * 1000 * n / small
+        except subprocess.TimeoutExpired:
+            print(f"  interpreter.py가 {name}에서 시간 초과되었습니다", file=sys.stderr)
+    return metrics
+
+
+# --- Reporting ---
+
+def regressions(results, baseline, threshold):
+    found = []
+    for name, metrics in results.items():
+        for metric, value in metrics.items():
+            old = baseline.get(name, {}).get(metric)
+            if not old or not value:
+                continue
+            worse = old / value - 1 if metric in HIGHER_IS_BETTER else value / old - 1
+            if worse > threshold:
+                found.append((name, metric, old, value, worse))
+    return found
+
+
+def print_table(results):
+    columns = ["tokens_per_s", "nodes_per_s", "translate_ms", "gxx_ms", "native_ms", "vm_ms", "python_ms"]
+    print(f"{'workload':<16}" + "".join(f"{column:>14}" for column in columns) + f"{'py/native':>11}")
+    for name, metrics in results.items():
+        cells = "".join(f"{metrics[c]:>14.4g}" if c in metrics else f"{'-':>14}" for c in columns)
+        speedup = metrics["python_ms"] / metrics["native_ms"] if "python_ms" in metrics and "native_ms" in metrics else None
+        print(f"{name:<16}{cells}" + (f"{speedup:>10.1f}x" if speedup else f"{'-':>11}"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mollang benchmark suite")
+    parser.add_argument("workloads", nargs="*", help="workloads to run (default: all)")
+    parser.add_argument("--compiler", help="compiler executable (default: build one from the repository)")
+    parser.add_argument("--work-dir", default=os.path.join(REPO_ROOT, "bench", "_work"))
+    parser.add_argument("--baseline", default=os.path.join(REPO_ROOT, "bench", "baseline.json"))
+    parser.add_argument("--save-baseline", action="store_true", help="store these results as the baseline")
+    parser.add_argument("--threshold", type=float, default=0.15, help="allowed slowdown before flagging (0.15 = 15%%)")
+    parser.add_argument("--scale", type=float, default=1.0, help="multiplier for every workload size")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per measurement; the best one counts")
+    parser.add_argument("--build", default="release", help="build profile of the native executables")
+    parser.add_argument("--no-python", action="store_true", help="skip interpreter.py")
+    parser.add_argument("--python-divisor", type=int, default=50)
+    parser.add_argument("--python-timeout", type=float, default=300)
+    args = parser.parse_args()
+
+    names = args.workloads or list(WORKLOADS)
+    unknown = [name for name in names if name not in WORKLOADS]
+    if unknown:
+        parser.error("unknown workloads: " + ", ".join(unknown) + " (available: " + ", ".join(WORKLOADS) + ")")
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    env = dict(os.environ, MOLLANG_CACHE_DIR=os.path.join(args.work_dir, "cache"), MOLLANG_RUNTIME_DIR=REPO_ROOT)
+    os.environ.update(env)
+    compiler = args.compiler or build_compiler(args.work_dir)
+
+    results = {}
+    for name in names:
+        print(f"[{name}]", file=sys.stderr)
+        results[name] = measure(name, args, compiler, args.work_dir, env)
+
+    print_table(results)
+    with open(os.path.join(args.work_dir, "results.json"), "w") as f:
+        json.dump(results, f, indent=2)
+
+    if args.save_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2)
+        print(f"기준값을 저장했습니다: {args.baseline}")
+        return 0
+    if not os.path.exists(args.baseline):
+        print(f"기준값 파일이 없습니다 ({args.baseline}). --save-baseline으로 만드세요.")
+        return 0
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+    found = regressions(results, baseline, args.threshold)
+    for name, metric, old, new, worse in found:
+        print(f"회귀: {name}.{metric}: {old:.4g} -> {new:.4g} ({worse:+.0%})")
+    if not found:
+        print(f"회귀 없음 (허용치 {args.threshold:.0%})")
+    return 1 if found else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
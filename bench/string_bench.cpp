@@ -0,0 +1,52 @@
+// String building benchmark: times string repetition, in-place appends and `x = x + y` in a
+// Mollang loop on the bytecode VM at growing sizes. Linear scaling shows up as a constant
+// MB/s column.
+//
+//   g++ -std=c++17 -O2 -o string_bench bench/string_bench.cpp mollang_runtime.cpp
+//   ./string_bench [max_mb]
+
+#define MOLLANG_NO_MAIN
+#include "../compiler.cpp"
+
+#include <chrono>
+
+template <typename Fn>
+double seconds(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+void report(const char* name, size_t mb, double elapsed) {
+    std::cout << name << ' ' << mb << " MB: " << elapsed * 1000 << " ms (" << mb / elapsed << " MB/s)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t max_mb = argc > 1 ? std::stoul(argv[1]) : 100;
+    const std::string chunk = "0123456789";
+
+    for (size_t mb = 1; mb <= max_mb; mb *= 10) {
+        size_t bytes = mb << 20;
+        std::string repeated;
+        double elapsed = seconds([&] { repeated = mollang_repeat(chunk, static_cast<int>(bytes / chunk.size())); });
+        report("repeat ", mb, elapsed);
+
+        MolObject text("");
+        MolObject suffix(chunk);
+        elapsed = seconds([&] {
+            while (text.as_string().size() < bytes) mollang_append(text, suffix);
+        });
+        report("append ", mb, elapsed);
+
+        std::string program = "밥 은 \"\"\n바압 은 0\n몰 바압 작 " + std::to_string(bytes / chunk.size()) +
+                              " [\n\t밥 은 밥 합 \"" + chunk + "\"\n\t바압 은 바압 합 1\n]\n";
+        Arena arena;
+        NodeList ast = parse_program(program, arena);
+        optimize(ast, arena, OPT_BASIC);
+        BytecodeProgram bytecode = BytecodeCompiler().compile(ast);
+        elapsed = seconds([&] { run_bytecode(bytecode); });
+        report("vm loop", mb, elapsed);
+    }
+    return 0;
+}
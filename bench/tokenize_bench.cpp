@@ -0,0 +1,124 @@
+// Tokenizer microbenchmark: compares the zero-copy tokenizer in compiler.cpp with the original
+// std::string-per-token implementation on a large synthetic program.
+//
+//   g++ -std=c++17 -O2 -o tokenize_bench bench/tokenize_bench.cpp mollang_runtime.cpp
+//   ./tokenize_bench [size_mb]
+
+#define MOLLANG_NO_MAIN
+#include "../compiler.cpp"
+
+#include <chrono>
+
+namespace legacy {
+
+struct Token {
+    TokenType type;
+    std::string value;
+};
+
+std::vector<Token> tokenize(const std::string& code) {
+    std::vector<Token> tokens;
+    for (size_t i = 0; i < code.length(); ) {
+        if (isspace(code[i])) {
+            i++;
+            continue;
+        }
+
+        if (code[i] == '[' || code[i] == ']') {
+            tokens.push_back({TokenType::SYMBOL, std::string(1, code[i])});
+            i++;
+            continue;
+        }
+
+        if (code[i] == '"' || code[i] == '\'') {
+            char quote = code[i];
+            i++;
+            size_t start = i;
+            while (i < code.length() && code[i] != quote) {
+                i++;
+            }
+            tokens.push_back({TokenType::STRING, code.substr(start, i - start)});
+            if (i < code.length()) {
+                i++;
+            }
+            continue;
+        }
+
+        size_t start = i;
+        while (i < code.length() && !isspace(code[i]) && code[i] != '[' && code[i] != ']') {
+            i++;
+        }
+        std::string value = code.substr(start, i - start);
+
+        if (value == "은" || value == "입" || value == "몰" || value == "캠프" || value == "퇴근" || value == "스크럼" || value == "뭐먹" ||
+            value == "덧셈" || value == "합" || value == "더하기" || value == "곱셈" || value == "곱" ||
+            value == "같" || value == "작" || value == "같작" || value == "작같" ||
+            value == "커서" || value == "지피티" || value == "제미나이" || value == "클로드" || value == "클라인" || value == "그록") {
+            tokens.push_back({TokenType::KEYWORD, value});
+        } else if (is_variable(value)) {
+            tokens.push_back({TokenType::IDENTIFIER, value});
+        } else {
+            try {
+                std::stoi(value);
+                tokens.push_back({TokenType::NUMBER, value});
+            } catch (const std::invalid_argument&) {
+                tokens.push_back({TokenType::IDENTIFIER, value});
+            }
+        }
+    }
+    tokens.push_back({TokenType::END_OF_FILE, ""});
+    return tokens;
+}
+
+} // namespace legacy
+
+// A mix of every token class: keywords, variables, numbers, strings and function names.
+std::string synthetic_program(size_t target_bytes) {
+    const std::string chunk =
+        "바아압 은 1\n"
+        "바아아압 은 \"몰\"\n"
+        "캠프 [ 바아압 작 1000 ]\n"
+        "    바아압 은 바아압 더하기 7\n"
+        "    바아아압 은 바아아압 곱 2\n"
+        "    몰 바아압\n"
+        "스크럼\n"
+        "뭐먹 캠프1 [\n"
+        "    퇴근 지피티\n"
+        "]\n"
+        "캠프1\n";
+    std::string code;
+    code.reserve(target_bytes + chunk.size());
+    while (code.size() < target_bytes) code += chunk;
+    return code;
+}
+
+template <typename Tokenize>
+double best_seconds(const std::string& code, Tokenize tokenize, size_t& count) {
+    double best = 1e30;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        count = tokenize(code).size();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    size_t size_mb = argc > 1 ? std::stoul(argv[1]) : 20;
+    std::string code = synthetic_program(size_mb << 20);
+
+    size_t current_count = 0, legacy_count = 0;
+    double current = best_seconds(code, [](const std::string& c) { return tokenize(c); }, current_count);
+    double old = best_seconds(code, [](const std::string& c) { return legacy::tokenize(c); }, legacy_count);
+
+    if (current_count != legacy_count) {
+        std::cerr << "token count mismatch: " << current_count << " vs " << legacy_count << std::endl;
+        return 1;
+    }
+    std::cout << "input:   " << code.size() / (1 << 20) << " MB, " << current_count << " tokens" << std::endl;
+    std::cout << "legacy:  " << old * 1000 << " ms (" << legacy_count / old / 1e6 << " Mtok/s)" << std::endl;
+    std::cout << "current: " << current * 1000 << " ms (" << current_count / current / 1e6 << " Mtok/s)" << std::endl;
+    std::cout << "speedup: " << old / current << "x" << std::endl;
+    return 0;
+}
@@ -0,0 +1,107 @@
+// Concurrent translation stress test: translates a mix of programs on many threads at once,
+// each translation with its own CompilationContext, and checks every result against a
+// single-threaded reference. Any difference means translation state leaked between
+// contexts. Build it with -fsanitize=thread to have races reported as well.
+//
+//   g++ -std=c++17 -O2 -pthread -o translate_stress bench/translate_stress.cpp mollang_runtime.cpp
+//   ./translate_stress [threads] [rounds]
+
+#define MOLLANG_NO_MAIN
+#include "../compiler.cpp"
+
+std::string many_functions(int count) {
+    std::string program = "바압 은 0\n";
+    std::string calls;
+    for (int i = 0; i < count; ++i) {
+        std::string name = "캠프";
+        for (int j = 0; j < i; ++j) name += "프";
+        program += name + " [\n";
+        for (int j = 0; j < (i % 2 == 0 ? 1 : 8); ++j) program += "\t바압 은 바압 더하기 " + std::to_string(i % 7 + 1) + "\n";
+        program += "]\n";
+        calls += "\t" + name + "\n";
+    }
+    return program + "밥 은 0\n몰 밥 작 100 [\n" + calls + "\t밥 은 밥 더하기 1\n]\n스크럼 바압\n";
+}
+
+std::string deep_nesting(int depth) {
+    std::string program = "밥 은 0\n바압 은 0\n몰 밥 작 10 [\n";
+    for (int level = 0; level < depth; ++level) {
+        program += std::string(level + 1, '\t') + "입 밥 작 " + std::to_string(10 + level) + " [\n";
+    }
+    program += std::string(depth + 1, '\t') + "바압 은 바압 더하기 1\n";
+    for (int level = depth; level-- > 0;) program += std::string(level + 1, '\t') + "]\n";
+    return program + "\t밥 은 밥 더하기 1\n]\n스크럼 바압\n";
+}
+
+int main(int argc, char* argv[]) {
+    unsigned threads = argc > 1 ? static_cast<unsigned>(std::stoul(argv[1])) : 8;
+    unsigned rounds = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 50;
+
+    const std::vector<std::string> programs = {
+        "밥 은 \"mol\"\n바압 은 0\n몰 바압 작 100 [\n\t밥 은 밥 더하기 \"lang\"\n\t바압 은 바압 더하기 1\n]\n"
+        "스크럼 밥\n스크럼 \"a\\\" 합 \"b\"\n",
+        "밥 은 뭐먹\n바압 은 뭐먹 합 뭐먹\n입 밥 같작 바압 [\n\t스크럼 밥 곱 3\n]\n스크럼 바압\n",
+        "바압 은 0\n몰몰 밥 은 0 작 1000 합 바압 [\n\t바아압 은 밥 곱 밥\n\t바압 은 바압 합 바아압\n]\n스크럼 바압\n",
+        many_functions(48),
+        deep_nesting(16),
+    };
+    std::vector<CompileOptions> variants(3);
+    variants[0].opt_level = OPT_NONE;
+    variants[1].opt_level = OPT_BASIC;
+    variants[2].opt_level = OPT_BASIC;
+    variants[2].profile = true;
+
+    // A '곱' reduction on a string cannot be split into chunks and must be rejected.
+    const std::string string_product = "바압 은 \"ab\"\n몰몰 밥 은 0 작 3 곱 바압 [\n\t바압 은 바압 곱 2\n]\n";
+    try {
+        CompilationContext ctx;
+        translate_to_cpp(ctx, string_product);
+        std::cerr << "a '곱' reduction on a string was accepted" << std::endl;
+        return 1;
+    } catch (const std::runtime_error&) {
+    }
+
+    std::vector<std::string> expected;
+    for (const std::string& program : programs) {
+        for (const CompileOptions& options : variants) {
+            CompilationContext ctx;
+            expected.push_back(translate_to_cpp(ctx, program, options));
+        }
+    }
+
+    std::atomic<size_t> translations{0};
+    std::atomic<size_t> mismatches{0};
+    std::mutex report_mutex;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (unsigned round = 0; round < rounds; ++round) {
+                // Threads start at different jobs, so different programs overlap.
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    size_t job = (i + t + round) % expected.size();
+                    CompilationContext ctx;
+                    std::string cpp;
+                    try {
+                        cpp = translate_to_cpp(ctx, programs[job / variants.size()], variants[job % variants.size()]);
+                    } catch (const std::exception& e) {
+                        cpp = std::string("error: ") + e.what();
+                    }
+                    ++translations;
+                    if (cpp != expected[job]) {
+                        ++mismatches;
+                        std::lock_guard<std::mutex> lock(report_mutex);
+                        std::cerr << "thread " << t << " round " << round << ": program " << job / variants.size()
+                                  << " variant " << job % variants.size() << " differs" << std::endl;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << translations << " translations on " << threads << " threads in " << elapsed.count() * 1000
+              << " ms, " << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : 1;
+}
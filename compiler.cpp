@@ -8,19 +8,57 @@
 #include <memory>
 #include <variant>
 #include <regex>
+#include <algorithm>
+#include <set>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string_view>
+#include <type_traits>
+#include <new>
+#include <charconv>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <initializer_list>
+#include <functional>
+#include <deque>
+#include <csignal>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mollang_runtime.hpp"
 
 // --- Forward Declarations ---
 struct ASTNode;
-std::string generate_cpp_code(const std::vector<std::unique_ptr<ASTNode>>& ast);
+struct NodeList;
+struct CompileOptions;
+struct CompilationContext;
+void generate_cpp_code(CompilationContext& ctx, const NodeList& ast, const CompileOptions& options, std::ostream& sink);
 
 // --- Helper Functions ---
-bool is_variable(const std::string& token) {
+bool is_variable(std::string_view token) {
     if (token == "밥") {
         return true;
     }
     // Using manual string checks instead of regex for UTF-8 compatibility
     // Assumes each Korean character is 3 bytes in UTF-8
-    if (token.length() >= 6 && token.rfind("바", 0) == 0 && token.substr(token.length() - 3) == "압") {
+    if (token.length() >= 6 && token.length() % 3 == 0 && token.substr(0, 3) == "바" && token.substr(token.length() - 3) == "압") {
         // Check if all characters in the middle are "아"
         for (size_t i = 3; i < token.length() - 3; i += 3) {
             if (token.substr(i, 3) != "아") {
@@ -32,6 +70,158 @@ bool is_variable(const std::string& token) {
     return false;
 }
 
+// --- Arena ---
+// Bump allocator that owns every AST node of one compilation, so the whole tree is released
+// at once. Objects are never destroyed individually, which is why make()
+// only accepts trivially destructible types.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t padding = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        if (padding + size > remaining) {
+            size_t block_size = std::max(BLOCK_SIZE, size + align);
+            blocks.emplace_back(new char[block_size]);
+            cursor = blocks.back().get();
+            remaining = block_size;
+            padding = (align - reinterpret_cast<uintptr_t>(cursor) % align) % align;
+        }
+        char* result = cursor + padding;
+        cursor = result + size;
+        remaining -= padding + size;
+        return result;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    std::string_view copy(std::string_view text) {
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::copy(text.begin(), text.end(), data);
+        return std::string_view(data, text.size());
+    }
+
+    template <typename T>
+    T* copy_array(const std::vector<T>& items) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+        T* data = static_cast<T*>(allocate(sizeof(T) * items.size(), alignof(T)));
+        std::copy(items.begin(), items.end(), data);
+        return data;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+};
+
+// --- Statistics ---
+// Optional per-phase wall time and peak memory of one compilation, reported by --stats.
+struct CompileStats {
+    struct Phase {
+        const char* name;
+        double milliseconds;
+        long peak_rss_kb; // high-water mark during the phase; for g++, of the largest child so far
+    };
+
+    std::vector<Phase> phases;
+    size_t source_bytes = 0;
+    size_t tokens = 0;
+    size_t ast_nodes = 0;
+    size_t optimized_ast_nodes = 0;
+    size_t variables = 0;
+    size_t functions = 0;
+    size_t emitted_bytes = 0;
+
+    double total_milliseconds() const {
+        double total = 0;
+        for (const auto& phase : phases) total += phase.milliseconds;
+        return total;
+    }
+
+    void write_text(std::ostream& out) const {
+        char line[96];
+        out << "통계:\n";
+        for (const auto& phase : phases) {
+            std::snprintf(line, sizeof(line), "  %-16s %10.3f ms %10ld KB\n", phase.name, phase.milliseconds, phase.peak_rss_kb);
+            out << line;
+        }
+        std::snprintf(line, sizeof(line), "  %-16s %10.3f ms\n", "total", total_milliseconds());
+        out << line;
+        out << "  소스 " << source_bytes << " bytes, 토큰 " << tokens << "개, AST 노드 " << ast_nodes << "개 (최적화 후 "
+            << optimized_ast_nodes << "개), 변수 " << variables << "개, 함수 " << functions << "개, 생성 코드 "
+            << emitted_bytes << " bytes\n";
+    }
+
+    void write_json(std::ostream& out) const {
+        char number[32];
+        out << "{\"phases\":[";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            std::snprintf(number, sizeof(number), "%.3f", phases[i].milliseconds);
+            out << (i ? "," : "") << "{\"name\":\"" << phases[i].name << "\",\"ms\":" << number
+                << ",\"peak_rss_kb\":" << phases[i].peak_rss_kb << '}';
+        }
+        std::snprintf(number, sizeof(number), "%.3f", total_milliseconds());
+        out << "],\"total_ms\":" << number << ",\"source_bytes\":" << source_bytes << ",\"tokens\":" << tokens
+            << ",\"ast_nodes\":" << ast_nodes << ",\"optimized_ast_nodes\":" << optimized_ast_nodes
+            << ",\"variables\":" << variables << ",\"functions\":" << functions
+            << ",\"emitted_bytes\":" << emitted_bytes << "}\n";
+    }
+};
+
+// Peak resident set size in KB. Linux tracks it as VmHWM, which reset_peak_rss() can lower
+// to the current size so each phase gets its own high-water mark.
+long peak_rss_kb(bool children = false) {
+    if (!children) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.rfind("VmHWM:", 0) == 0) return std::strtol(line.c_str() + 6, nullptr, 10);
+        }
+    }
+    rusage usage{};
+    getrusage(children ? RUSAGE_CHILDREN : RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void reset_peak_rss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+// Records the enclosing scope as one phase of `stats`; does nothing when stats is null.
+class PhaseTimer {
+public:
+    PhaseTimer(CompileStats* stats, const char* name, bool child_process = false)
+        : stats(stats), name(name), child_process(child_process) {
+        if (!stats) return;
+        if (!child_process) reset_peak_rss();
+        start = std::chrono::steady_clock::now();
+    }
+    ~PhaseTimer() {
+        if (!stats) return;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        stats->phases.push_back({name, elapsed.count(), peak_rss_kb(child_process)});
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    CompileStats* stats;
+    const char* name;
+    bool child_process;
+    std::chrono::steady_clock::time_point start;
+};
+
+
 // --- Tokenizer ---
 enum class TokenType {
     KEYWORD, IDENTIFIER, NUMBER, STRING, SYMBOL, END_OF_FILE
@@ -39,206 +229,495 @@ enum class TokenType {
 
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value; // points into the source text, which must outlive the AST
+    int number = 0;         // decoded value of a NUMBER token
+    int line = 0;           // 1-based position of the first character, for diagnostics
+    int column = 0;         // and --profile; columns count characters, not bytes
 };
 
-std::vector<Token> tokenize(const std::string& code) {
-    std::vector<Token> tokens;
-    for (size_t i = 0; i < code.length(); ) {
-        if (isspace(code[i])) {
-            i++;
-            continue;
-        }
+// Keywords are found with a perfect hash: the top five bits of a seeded 32-bit FNV-1a hash
+// index a 32-slot table. The seed was searched offline so that no two keywords share a
+// slot, and the static_assert below re-checks that whenever the list changes.
+constexpr std::string_view KEYWORDS[] = {
+    "은", "입", "몰", "몰몰", "캠프", "퇴근", "스크럼", "뭐먹",
+    "덧셈", "합", "더하기", "곱셈", "곱",
+    "같", "작", "같작", "작같",
+    "커서", "지피티", "제미나이", "클로드", "클라인", "그록",
+};
+constexpr uint32_t KEYWORD_HASH_SEED = 90141;
+constexpr size_t KEYWORD_TABLE_BITS = 5;
+constexpr size_t MAX_KEYWORD_LENGTH = 12;
 
-        if (code[i] == '[' || code[i] == ']') {
-            tokens.push_back({TokenType::SYMBOL, std::string(1, code[i])});
-            i++;
-            continue;
-        }
+constexpr uint32_t keyword_hash(std::string_view text) {
+    uint32_t h = KEYWORD_HASH_SEED;
+    for (char c : text) {
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return h >> (32 - KEYWORD_TABLE_BITS);
+}
 
-        if (code[i] == '"' || code[i] == '\'') {
-            char quote = code[i];
-            i++;
-            size_t start = i;
-            while (i < code.length() && code[i] != quote) {
-                i++;
-            }
-            tokens.push_back({TokenType::STRING, code.substr(start, i - start)});
-            if (i < code.length()) {
-                i++; // Skip closing quote
-            }
-            continue;
-        }
+struct KeywordTable {
+    std::string_view slots[1 << KEYWORD_TABLE_BITS] = {};
+    bool perfect = true;
+};
 
-        size_t start = i;
-        while (i < code.length() && !isspace(code[i]) && code[i] != '[' && code[i] != ']') {
-            i++;
-        }
-        std::string value = code.substr(start, i - start);
-        
-        if (value.empty()) continue;
-
-        if (value == "은" || value == "입" || value == "몰" || value == "캠프" || value == "퇴근" || value == "스크럼" || value == "뭐먹" ||
-            value == "덧셈" || value == "합" || value == "더하기" || value == "곱셈" || value == "곱" ||
-            value == "같" || value == "작" || value == "같작" || value == "작같" ||
-            value == "커서" || value == "지피티" || value == "제미나이" || value == "클로드" || value == "클라인" || value == "그록") {
-            tokens.push_back({TokenType::KEYWORD, value});
-        } else if (is_variable(value)) {
-            tokens.push_back({TokenType::IDENTIFIER, value});
-        } else {
-            try {
-                std::stoi(value);
-                tokens.push_back({TokenType::NUMBER, value});
-            } catch (const std::invalid_argument&) {
-                // It can be a function name like 캠프1, 캠프2 etc.
-                tokens.push_back({TokenType::IDENTIFIER, value});
-            }
-        }
+constexpr KeywordTable make_keyword_table() {
+    KeywordTable table;
+    for (std::string_view keyword : KEYWORDS) {
+        std::string_view& slot = table.slots[keyword_hash(keyword)];
+        if (!slot.empty() || keyword.size() > MAX_KEYWORD_LENGTH) table.perfect = false;
+        slot = keyword;
     }
-    tokens.push_back({TokenType::END_OF_FILE, ""});
-    return tokens;
+    return table;
 }
 
+constexpr KeywordTable KEYWORD_TABLE = make_keyword_table();
+static_assert(KEYWORD_TABLE.perfect, "KEYWORD_HASH_SEED no longer hashes every keyword to its own slot");
 
-// --- AST ---
-struct ASTNode {
-    virtual ~ASTNode() = default;
-    virtual std::string generate() const = 0;
+bool is_keyword(std::string_view text) {
+    return text.size() <= MAX_KEYWORD_LENGTH && KEYWORD_TABLE.slots[keyword_hash(text)] == text;
+}
+
+// Decodes an optionally signed decimal literal. Returns false if `text` is not entirely a
+// number, e.g. function names like 캠프1.
+bool decode_number(std::string_view text, int& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    if (first != last && *first == '+') ++first; // from_chars only accepts '-'
+    if (first == last || (*first != '-' && !isdigit(static_cast<unsigned char>(*first)))) return false;
+    auto result = std::from_chars(first, last, value);
+    if (result.ptr != last) return false;
+    if (result.ec == std::errc::result_out_of_range) {
+        throw std::runtime_error("Number out of range: " + std::string(text));
+    }
+    return result.ec == std::errc();
+}
+
+bool is_token_break(char c) {
+    return isspace(static_cast<unsigned char>(c)) || c == '[' || c == ']';
+}
+
+// Pull-based tokenizer: the parser asks for one token at a time, so the program is never
+// held as a token array. Tokens view the source text, which must outlive the AST.
+class Lexer {
+public:
+    explicit Lexer(std::string_view source) : source(source) {}
+
+    // The END_OF_FILE token is returned again once the source is exhausted.
+    Token next();
+
+    size_t tokens_produced() const { return produced; }
+
+private:
+    std::string_view source;
+    size_t pos = 0;
+    size_t produced = 0;
+    // Newlines are only found between tokens or inside strings, where they restart the
+    // column count; columns are advanced from the previous token, so each byte is seen once.
+    int line = 1, column = 1;
+    size_t scanned = 0;
+
+    void new_line(size_t next) {
+        ++line;
+        column = 1;
+        scanned = next;
+    }
+
+    Token make(TokenType type, size_t start, std::string_view value, int number = 0) {
+        for (; scanned < start; ++scanned) {
+            column += (static_cast<unsigned char>(source[scanned]) & 0xC0) != 0x80; // skip UTF-8 continuations
+        }
+        ++produced;
+        return Token{type, value, number, line, column};
+    }
 };
 
-// Global context for variable and function names
-std::map<std::string, std::string> variable_map;
-int var_counter = 0;
-std::map<std::string, std::string> function_map;
-int func_counter = 0;
+Token Lexer::next() {
+    while (pos < source.size() && isspace(static_cast<unsigned char>(source[pos]))) {
+        if (source[pos] == '\n') new_line(pos + 1);
+        pos++;
+    }
+    if (pos == source.size()) {
+        return make(TokenType::END_OF_FILE, pos, "");
+    }
 
-std::string get_cpp_var(const std::string& mol_var) {
-    if (variable_map.find(mol_var) == variable_map.end()) {
-        variable_map[mol_var] = "var_" + std::to_string(var_counter++);
+    if (source[pos] == '[' || source[pos] == ']') {
+        pos++;
+        return make(TokenType::SYMBOL, pos - 1, source.substr(pos - 1, 1));
     }
-    return variable_map[mol_var];
-}
 
-std::string get_cpp_func(const std::string& mol_func) {
-    if (function_map.find(mol_func) == function_map.end()) {
-        function_map[mol_func] = "func_" + std::to_string(func_counter++);
+    if (source[pos] == '"' || source[pos] == '\'') {
+        size_t quote = pos++;
+        size_t end = source.find(source[quote], pos);
+        if (end == std::string_view::npos) end = source.size();
+        Token token = make(TokenType::STRING, quote, source.substr(pos, end - pos));
+        for (size_t n = pos; (n = source.find('\n', n)) < end; ++n) new_line(n + 1);
+        pos = end < source.size() ? end + 1 : end; // Skip closing quote
+        return token;
+    }
+
+    size_t start = pos;
+    while (pos < source.size() && !is_token_break(source[pos])) {
+        pos++;
+    }
+    std::string_view value = source.substr(start, pos - start);
+
+    int number = 0;
+    if (is_keyword(value)) {
+        return make(TokenType::KEYWORD, start, value);
+    } else if (is_variable(value)) {
+        return make(TokenType::IDENTIFIER, start, value);
+    } else if (decode_number(value, number)) {
+        return make(TokenType::NUMBER, start, value, number);
     }
-    return function_map[mol_func];
+    // It can be a function name like 캠프1, 캠프2 etc.
+    return make(TokenType::IDENTIFIER, start, value);
+}
+
+// The whole token list, ending with END_OF_FILE. The compiler itself streams tokens; this
+// is for tools that want them all.
+std::vector<Token> tokenize(std::string_view code) {
+    Lexer lexer(code);
+    std::vector<Token> tokens;
+    tokens.reserve(code.size() / 4);
+    do {
+        tokens.push_back(lexer.next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
+    return tokens;
+}
+
+
+// --- AST ---
+// Set of runtime types an expression may evaluate to, one bit per alternative of MolObject's variant.
+using TypeSet = unsigned;
+const TypeSet TYPE_NONE = 1 << 0; // std::monostate (unassigned variable)
+const TypeSet TYPE_INT = 1 << 1;
+const TypeSet TYPE_STRING = 1 << 2;
+const TypeSet TYPE_BOOL = 1 << 3;
+
+bool is_single_type(TypeSet t) {
+    return t == TYPE_INT || t == TYPE_STRING || t == TYPE_BOOL;
 }
 
+enum class NodeKind {
+    NUMBER, STRING, BOOL, VARIABLE, INPUT, BINARY_OP,
+    ASSIGN, PRINT, IF, WHILE, PARALLEL, FUNC_DEF, FUNC_CALL, RETURN
+};
+
+struct ASTNode {
+    NodeKind kind;
+    // Filled in by infer_types() for expression nodes. A native node generates a plain
+    // int/std::string/bool C++ expression instead of a MolObject.
+    TypeSet type = 0;
+    bool native = false;
+    // Source position of a statement's first token, set by the parser; fits in the padding.
+    unsigned short column = 0;
+    int line = 0;
+
+    explicit ASTNode(NodeKind k) : kind(k) {}
+};
+
+// Arena-allocated list of child statements.
+struct NodeList {
+    ASTNode** items = nullptr;
+    size_t count = 0;
+
+    ASTNode* const* begin() const { return items; }
+    ASTNode* const* end() const { return items + count; }
+    size_t size() const { return count; }
+};
 
 struct NumberNode : ASTNode {
-    std::string value;
-    NumberNode(std::string v) : value(v) {}
-    std::string generate() const override { return "MolObject(" + value + ")"; }
+    static constexpr NodeKind KIND = NodeKind::NUMBER;
+    int value;
+    NumberNode(int v) : ASTNode(KIND), value(v) {}
 };
 
 struct StringNode : ASTNode {
-    std::string value;
-    StringNode(std::string v) : value(v) {}
-    std::string generate() const override { return "MolObject(std::string(\"" + value + "\"))"; }
+    static constexpr NodeKind KIND = NodeKind::STRING;
+    std::string_view value;
+    StringNode(std::string_view v) : ASTNode(KIND), value(v) {}
+};
+
+// Only produced by the optimizer, when it folds a comparison.
+struct BoolNode : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::BOOL;
+    bool value;
+    BoolNode(bool v) : ASTNode(KIND), value(v) {}
 };
 
 struct VariableNode : ASTNode {
-    std::string name;
-    VariableNode(std::string n) : name(n) {}
-    std::string generate() const override { return get_cpp_var(name); }
+    static constexpr NodeKind KIND = NodeKind::VARIABLE;
+    std::string_view name;
+    VariableNode(std::string_view n) : ASTNode(KIND), name(n) {}
 };
 
 struct InputNode : ASTNode {
-    std::string generate() const override { return "mollang_input()"; }
+    static constexpr NodeKind KIND = NodeKind::INPUT;
+    InputNode() : ASTNode(KIND) {}
 };
 
 struct BinaryOpNode : ASTNode {
-    std::unique_ptr<ASTNode> left;
-    std::string op;
-    std::unique_ptr<ASTNode> right;
-    BinaryOpNode(std::unique_ptr<ASTNode> l, std::string o, std::unique_ptr<ASTNode> r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
-    std::string generate() const override {
-        return "(" + left->generate() + " " + op + " " + right->generate() + ")";
-    }
+    static constexpr NodeKind KIND = NodeKind::BINARY_OP;
+    ASTNode* left;
+    std::string_view op;
+    ASTNode* right;
+    BinaryOpNode(ASTNode* l, std::string_view o, ASTNode* r) : ASTNode(KIND), left(l), op(o), right(r) {}
 };
 
 struct AssignNode : ASTNode {
-    std::string var_name;
-    std::unique_ptr<ASTNode> expr;
-    AssignNode(std::string n, std::unique_ptr<ASTNode> e) : var_name(n), expr(std::move(e)) {}
-    std::string generate() const override {
-        return get_cpp_var(var_name) + " = " + expr->generate() + ";";
-    }
+    static constexpr NodeKind KIND = NodeKind::ASSIGN;
+    std::string_view var_name;
+    ASTNode* expr;
+    AssignNode(std::string_view n, ASTNode* e) : ASTNode(KIND), var_name(n), expr(e) {}
 };
 
 struct PrintNode : ASTNode {
-    std::unique_ptr<ASTNode> expr;
-    PrintNode(std::unique_ptr<ASTNode> e) : expr(std::move(e)) {}
-    std::string generate() const override {
-        return "mollang_print(" + expr->generate() + ");";
-    }
+    static constexpr NodeKind KIND = NodeKind::PRINT;
+    ASTNode* expr;
+    PrintNode(ASTNode* e) : ASTNode(KIND), expr(e) {}
 };
 
 struct IfNode : ASTNode {
-    std::unique_ptr<ASTNode> condition;
-    std::vector<std::unique_ptr<ASTNode>> body;
-    IfNode(std::unique_ptr<ASTNode> c, std::vector<std::unique_ptr<ASTNode>> b)
-        : condition(std::move(c)), body(std::move(b)) {}
-    std::string generate() const override {
-        std::stringstream ss;
-        ss << "if (std::get<bool>(" << condition->generate() << ".value)) {\n";
-        for (const auto& stmt : body) {
-            ss << "    " << stmt->generate() << "\n";
-        }
-        ss << "}";
-        return ss.str();
-    }
+    static constexpr NodeKind KIND = NodeKind::IF;
+    ASTNode* condition;
+    NodeList body;
+    IfNode(ASTNode* c, NodeList b) : ASTNode(KIND), condition(c), body(b) {}
 };
 
 struct WhileNode : ASTNode {
-    std::unique_ptr<ASTNode> condition;
-    std::vector<std::unique_ptr<ASTNode>> body;
-    WhileNode(std::unique_ptr<ASTNode> c, std::vector<std::unique_ptr<ASTNode>> b)
-        : condition(std::move(c)), body(std::move(b)) {}
-    std::string generate() const override {
-        std::stringstream ss;
-        ss << "while (std::get<bool>(" << condition->generate() << ".value)) {\n";
-        for (const auto& stmt : body) {
-            ss << "    " << stmt->generate() << "\n";
-        }
-        ss << "}";
-        return ss.str();
-    }
+    static constexpr NodeKind KIND = NodeKind::WHILE;
+    ASTNode* condition;
+    NodeList body;
+    WhileNode(ASTNode* c, NodeList b) : ASTNode(KIND), condition(c), body(b) {}
+};
+
+// A reduction variable of a '몰몰' loop and its operator, "+" or "*".
+struct Reduction {
+    std::string_view var_name;
+    std::string_view op;
+};
+
+// '몰몰 i 은 a 작 b [합 s|곱 p]... [ ... ]': runs the body once for every i from a to b - 1, with
+// the iterations spread over threads. The index and every other variable the body assigns
+// are private to an iteration; reduction variables are private to a thread until they are
+// combined after the loop. Parser::check_parallel_body() enforces what the body may do.
+struct ParallelNode : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::PARALLEL;
+    std::string_view index;
+    ASTNode* begin;
+    ASTNode* end;
+    const Reduction* reductions;
+    size_t reduction_count;
+    NodeList body;
+    ParallelNode(std::string_view i, ASTNode* b, ASTNode* e, const Reduction* r, size_t n, NodeList body)
+        : ASTNode(KIND), index(i), begin(b), end(e), reductions(r), reduction_count(n), body(body) {}
+
+    const Reduction* reductions_begin() const { return reductions; }
+    const Reduction* reductions_end() const { return reductions + reduction_count; }
 };
 
 struct FuncDefNode : ASTNode {
-    std::string name;
-    std::vector<std::unique_ptr<ASTNode>> body;
-    FuncDefNode(std::string n, std::vector<std::unique_ptr<ASTNode>> b)
-        : name(n), body(std::move(b)) {}
-    std::string generate() const override {
-        std::stringstream ss;
-        ss << "MolObject " << get_cpp_func(name) << "() {\n";
-        for (const auto& stmt : body) {
-            ss << stmt->generate() << "\n";
-        }
-        ss << "return MolObject();\n"; // Default return
-        ss << "}";
-        return ss.str();
-    }
+    static constexpr NodeKind KIND = NodeKind::FUNC_DEF;
+    std::string_view name;
+    NodeList body;
+    FuncDefNode(std::string_view n, NodeList b) : ASTNode(KIND), name(n), body(b) {}
 };
 
 struct FuncCallNode : ASTNode {
-    std::string name;
-    FuncCallNode(std::string n) : name(n) {}
-    std::string generate() const override {
-        return get_cpp_func(name) + "();";
-    }
+    static constexpr NodeKind KIND = NodeKind::FUNC_CALL;
+    std::string_view name;
+    FuncCallNode(std::string_view n) : ASTNode(KIND), name(n) {}
 };
 
 struct ReturnNode : ASTNode {
-    std::unique_ptr<ASTNode> expr;
-    ReturnNode(std::unique_ptr<ASTNode> e) : expr(std::move(e)) {}
-    std::string generate() const override {
-        return "return " + expr->generate() + ";";
+    static constexpr NodeKind KIND = NodeKind::RETURN;
+    ASTNode* expr;
+    ReturnNode(ASTNode* e) : ASTNode(KIND), expr(e) {}
+};
+
+// `const To` if `From` is const, so helpers below work on both const and mutable trees.
+template <typename To, typename From>
+using match_const = typename std::conditional<std::is_const<From>::value, const To, To>::type;
+
+// Checked downcast by node kind, returning nullptr on mismatch.
+template <typename T, typename Node>
+match_const<T, Node>* node_cast(Node* node) {
+    return node->kind == T::KIND ? static_cast<match_const<T, Node>*>(node) : nullptr;
+}
+
+// Calls visitor(node) with `node` downcast to its concrete type. Every pass dispatches through
+// this single switch, so a visitor needs one overload per node type it handles.
+template <typename Node, typename Visitor>
+decltype(auto) visit(Node* node, Visitor&& visitor) {
+    switch (node->kind) {
+    case NodeKind::NUMBER: return visitor(static_cast<match_const<NumberNode, Node>*>(node));
+    case NodeKind::STRING: return visitor(static_cast<match_const<StringNode, Node>*>(node));
+    case NodeKind::BOOL: return visitor(static_cast<match_const<BoolNode, Node>*>(node));
+    case NodeKind::VARIABLE: return visitor(static_cast<match_const<VariableNode, Node>*>(node));
+    case NodeKind::INPUT: return visitor(static_cast<match_const<InputNode, Node>*>(node));
+    case NodeKind::BINARY_OP: return visitor(static_cast<match_const<BinaryOpNode, Node>*>(node));
+    case NodeKind::ASSIGN: return visitor(static_cast<match_const<AssignNode, Node>*>(node));
+    case NodeKind::PRINT: return visitor(static_cast<match_const<PrintNode, Node>*>(node));
+    case NodeKind::IF: return visitor(static_cast<match_const<IfNode, Node>*>(node));
+    case NodeKind::WHILE: return visitor(static_cast<match_const<WhileNode, Node>*>(node));
+    case NodeKind::PARALLEL: return visitor(static_cast<match_const<ParallelNode, Node>*>(node));
+    case NodeKind::FUNC_DEF: return visitor(static_cast<match_const<FuncDefNode, Node>*>(node));
+    case NodeKind::FUNC_CALL: return visitor(static_cast<match_const<FuncCallNode, Node>*>(node));
+    case NodeKind::RETURN: return visitor(static_cast<match_const<ReturnNode, Node>*>(node));
+    }
+    throw std::logic_error("Unknown AST node kind");
+}
+
+// Calls fn on every direct child of `node` in evaluation order: operands, then the
+// condition, then body statements.
+template <typename Node, typename Fn>
+void for_each_child(Node* node, Fn&& fn) {
+    switch (node->kind) {
+    case NodeKind::BINARY_OP: {
+        auto* binary_op_node = static_cast<match_const<BinaryOpNode, Node>*>(node);
+        fn(binary_op_node->left);
+        fn(binary_op_node->right);
+        break;
+    }
+    case NodeKind::ASSIGN: fn(static_cast<match_const<AssignNode, Node>*>(node)->expr); break;
+    case NodeKind::PRINT: fn(static_cast<match_const<PrintNode, Node>*>(node)->expr); break;
+    case NodeKind::RETURN: fn(static_cast<match_const<ReturnNode, Node>*>(node)->expr); break;
+    case NodeKind::IF: {
+        auto* if_node = static_cast<match_const<IfNode, Node>*>(node);
+        fn(if_node->condition);
+        for (ASTNode* stmt : if_node->body) fn(stmt);
+        break;
+    }
+    case NodeKind::WHILE: {
+        auto* while_node = static_cast<match_const<WhileNode, Node>*>(node);
+        fn(while_node->condition);
+        for (ASTNode* stmt : while_node->body) fn(stmt);
+        break;
+    }
+    case NodeKind::PARALLEL: {
+        auto* parallel_node = static_cast<match_const<ParallelNode, Node>*>(node);
+        fn(parallel_node->begin);
+        fn(parallel_node->end);
+        for (ASTNode* stmt : parallel_node->body) fn(stmt);
+        break;
+    }
+    case NodeKind::FUNC_DEF:
+        for (ASTNode* stmt : static_cast<match_const<FuncDefNode, Node>*>(node)->body) fn(stmt);
+        break;
+    default:
+        break;
+    }
+}
+
+void collect_parallel_assignments(const ASTNode* node, std::set<std::string_view>& vars) {
+    if (const auto* assign_node = node_cast<AssignNode>(node)) vars.insert(assign_node->var_name);
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        // A nested loop's own variables are private to it; its reductions are assigned when it ends.
+        for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+            vars.insert(r->var_name);
+        }
+        return;
+    }
+    for_each_child(node, [&](const ASTNode* child) { collect_parallel_assignments(child, vars); });
+}
+
+// The variables that start out unassigned in every iteration of a '몰몰' loop: everything its
+// body assigns except the reductions.
+std::set<std::string_view> iteration_private_vars(const ParallelNode* node) {
+    std::set<std::string_view> vars;
+    for (const ASTNode* stmt : node->body) collect_parallel_assignments(stmt, vars);
+    for (const Reduction* r = node->reductions_begin(); r != node->reductions_end(); ++r) vars.erase(r->var_name);
+    return vars;
+}
+
+// A '몰' loop with a single induction variable, found by analyze_loops(): the condition is
+// `var < bound`, `bound < var` or the same with '<=', the bound is a literal or a variable the
+// loop never assigns, and the last statement of the body, its only assignment to `var`, adds
+// a constant that moves `var` towards the bound. It is generated as a C++ for loop over an
+// int local that stands in for `var` in the body.
+struct CountedLoop {
+    std::string_view var;
+    const ASTNode* bound;
+    bool bound_first; // `bound < var`: counts down
+    int step;
+    bool guarded; // the condition may throw, so its first test runs as written
+    bool sync;    // the body calls a function or returns, so `var` is stored every iteration
+    std::vector<const ASTNode*> reads;       // of `var` in the body, retyped to a native int
+    std::vector<const ASTNode*> bound_reads; // of a variable bound, which is an int as well
+    std::vector<const ASTNode*> invariants; // int arithmetic on unchanging values, computed once
+    // Products of `var` and a literal or an unchanging variable, kept as running sums.
+    struct Scaled {
+        const ASTNode* factor;
+        std::vector<const ASTNode*> products;
+    };
+    std::vector<Scaled> scaled;
+};
+
+// Per-compilation state: the C++ names given to Mollang variables and functions, and the
+// types inferred for them. Every pass that needs it takes the context explicitly, so
+// independent compilations can run on different threads.
+struct CompilationContext {
+    std::map<std::string, std::string, std::less<>> variable_map;
+    int var_counter = 0;
+    std::map<std::string, std::string, std::less<>> function_map;
+    int func_counter = 0;
+    std::map<std::string, TypeSet, std::less<>> variable_types;
+    std::map<std::string, TypeSet, std::less<>> function_return_types;
+    std::map<const ASTNode*, CountedLoop> counted_loops; // '몰' nodes, filled in by analyze_loops()
+    CompileStats* stats = nullptr; // filled in by the compilation when set
+    // Name symbols after the hex bytes of their Mollang name instead of numbering them in
+    // order of appearance, so a name does not change when code elsewhere does.
+    bool stable_names = false;
+
+    void reset() {
+        CompileStats* kept = stats;
+        bool kept_stable_names = stable_names;
+        *this = CompilationContext();
+        stats = kept;
+        stable_names = kept_stable_names;
+    }
+
+    const std::string& get_cpp_var(std::string_view mol_var) {
+        auto it = variable_map.find(mol_var);
+        if (it == variable_map.end()) {
+            it = variable_map.emplace(std::string(mol_var), cpp_name("var_", mol_var, var_counter)).first;
+        }
+        return it->second;
+    }
+
+    const std::string& get_cpp_func(std::string_view mol_func) {
+        auto it = function_map.find(mol_func);
+        if (it == function_map.end()) {
+            it = function_map.emplace(std::string(mol_func), cpp_name("func_", mol_func, func_counter)).first;
+        }
+        return it->second;
+    }
+
+    std::string cpp_name(const char* prefix, std::string_view mol_name, int& counter) {
+        std::string name = prefix;
+        if (!stable_names) return name + std::to_string(counter++);
+        static const char digits[] = "0123456789abcdef";
+        for (unsigned char c : mol_name) {
+            name += digits[c >> 4];
+            name += digits[c & 15];
+        }
+        return name;
+    }
+
+    TypeSet variable_type(std::string_view mol_var) const {
+        auto it = variable_types.find(mol_var);
+        return it != variable_types.end() ? it->second : TYPE_NONE;
+    }
+
+    bool is_native_var(std::string_view mol_var) const {
+        return is_single_type(variable_type(mol_var));
+    }
+
+    // 0 for a function that never returns a value, TYPE_NONE if it is not defined.
+    TypeSet function_return_type(std::string_view mol_func) const {
+        auto it = function_return_types.find(mol_func);
+        return it != function_return_types.end() ? it->second : TYPE_NONE;
     }
 };
 
@@ -246,377 +725,4192 @@ struct ReturnNode : ASTNode {
 // --- Parser ---
 class Parser {
 public:
-    Parser(std::vector<Token> tokens) : tokens(std::move(tokens)), pos(0) {}
+    Parser(std::string_view source, Arena& arena) : lexer(source), current(lexer.next()), arena(arena) {}
 
-    std::vector<std::unique_ptr<ASTNode>> parse() {
-        std::vector<std::unique_ptr<ASTNode>> statements;
+    NodeList parse() {
+        std::vector<ASTNode*> statements;
         while (peek().type != TokenType::END_OF_FILE) {
             statements.push_back(parse_statement());
         }
-        return statements;
+        return make_list(statements);
     }
 
+    size_t tokens_read() const { return lexer.tokens_produced(); }
+
 private:
-    std::vector<Token> tokens;
-    size_t pos;
+    Lexer lexer;
+    Token current;     // the one token of lookahead
+    bool past_end = false; // END_OF_FILE was consumed
+    Arena& arena;
+
+    NodeList make_list(const std::vector<ASTNode*>& statements) {
+        return NodeList{arena.copy_array(statements), statements.size()};
+    }
 
-    Token peek() {
-        if (pos >= tokens.size()) {
+    const Token& peek() const {
+        if (past_end) {
             throw std::runtime_error("Parser error: Unexpected end of file while peeking.");
         }
-        return tokens[pos];
+        return current;
     }
     Token consume() {
-        if (pos >= tokens.size()) {
+        if (past_end) {
             throw std::runtime_error("Parser error: Unexpected end of file while consuming.");
         }
-        return tokens[pos++];
+        Token token = current;
+        if (token.type == TokenType::END_OF_FILE) {
+            past_end = true;
+        } else {
+            current = lexer.next();
+        }
+        return token;
     }
     
-    std::unique_ptr<ASTNode> parse_statement();
-    std::unique_ptr<ASTNode> parse_expression();
-    std::unique_ptr<ASTNode> parse_simple_expr();
-    std::vector<std::unique_ptr<ASTNode>> parse_block();
-    std::string get_operator(const std::string& token);
+    template <typename T, typename... Args>
+    T* make_statement(const Token& start, Args&&... args) {
+        T* node = arena.make<T>(std::forward<Args>(args)...);
+        node->line = start.line;
+        node->column = static_cast<unsigned short>(std::min(start.column, 0xFFFF));
+        return node;
+    }
+
+    void expect(std::string_view value) {
+        if (consume().value != value) {
+            throw std::runtime_error("Parser error: Expected '" + std::string(value) + "'.");
+        }
+    }
+
+    ASTNode* parse_statement();
+    ASTNode* parse_parallel(const Token& start);
+    void check_parallel_body(const ParallelNode* loop, const ASTNode* node, bool nested_loop);
+    ASTNode* parse_expression();
+    ASTNode* parse_simple_expr();
+    NodeList parse_block();
+    std::string_view get_operator(std::string_view token);
 };
 
-std::unique_ptr<ASTNode> Parser::parse_statement() {
+ASTNode* Parser::parse_statement() {
     Token token = peek();
     if (is_variable(token.value)) {
-        std::string var_name = consume().value;
+        std::string_view var_name = consume().value;
         consume(); // '은'
         auto expr = parse_expression();
-        return std::make_unique<AssignNode>(var_name, std::move(expr));
+        return make_statement<AssignNode>(token, var_name, expr);
     }
     if (token.value == "스크럼") {
         consume();
         auto expr = parse_expression();
-        return std::make_unique<PrintNode>(std::move(expr));
+        return make_statement<PrintNode>(token, expr);
     }
     if (token.value == "입") {
         consume();
         auto cond = parse_expression();
         auto body = parse_block();
-        return std::make_unique<IfNode>(std::move(cond), std::move(body));
+        return make_statement<IfNode>(token, cond, body);
     }
     if (token.value == "몰") {
         consume();
         auto cond = parse_expression();
         auto body = parse_block();
-        return std::make_unique<WhileNode>(std::move(cond), std::move(body));
+        return make_statement<WhileNode>(token, cond, body);
+    }
+    if (token.value == "몰몰") {
+        consume();
+        return parse_parallel(token);
     }
     if (token.value.rfind("캠프", 0) == 0) { // starts with 캠프
-        std::string func_name = consume().value;
+        std::string_view func_name = consume().value;
         if (peek().value == "[") {
             auto body = parse_block();
-            return std::make_unique<FuncDefNode>(func_name, std::move(body));
+            return make_statement<FuncDefNode>(token, func_name, body);
         } else {
-            return std::make_unique<FuncCallNode>(func_name);
+            return make_statement<FuncCallNode>(token, func_name);
         }
     }
     if (token.value == "퇴근") {
         consume();
         auto expr = parse_expression();
-        return std::make_unique<ReturnNode>(std::move(expr));
+        return make_statement<ReturnNode>(token, expr);
+    }
+    throw std::runtime_error("Invalid statement start: '" + std::string(token.value) + "'");
+}
+
+// The bounds are single terms, since a reduction list may follow the end bound.
+ASTNode* Parser::parse_parallel(const Token& start) {
+    Token index = consume();
+    if (!is_variable(index.value)) {
+        throw std::runtime_error("Parser error: '몰몰' needs a loop variable, got '" + std::string(index.value) + "'.");
     }
-    throw std::runtime_error("Invalid statement start: '" + token.value + "'");
+    expect("은");
+    ASTNode* begin = parse_simple_expr();
+    expect("작");
+    ASTNode* end = parse_simple_expr();
+    std::vector<Reduction> reductions;
+    while (peek().value != "[") {
+        std::string_view op = get_operator(consume().value);
+        Token var = consume();
+        if ((op != "+" && op != "*") || !is_variable(var.value)) {
+            throw std::runtime_error("Parser error: '몰몰' reductions are '합 <variable>' or '곱 <variable>'.");
+        }
+        for (const Reduction& r : reductions) {
+            if (r.var_name == var.value) {
+                throw std::runtime_error("Parser error: '" + std::string(var.value) + "' is reduced more than once.");
+            }
+        }
+        if (var.value == index.value) {
+            throw std::runtime_error("Parser error: The loop variable of '몰몰' cannot be a reduction.");
+        }
+        reductions.push_back({var.value, op});
+    }
+    auto body = parse_block();
+    auto* loop = make_statement<ParallelNode>(start, index.value, begin, end, arena.copy_array(reductions),
+                                              reductions.size(), body);
+    for (const ASTNode* stmt : body) check_parallel_body(loop, stmt, false);
+    return loop;
+}
+
+// Iterations of a '몰몰' body run in any order on any thread, so the body must not return, read
+// input, define functions or assign the loop variable, and may only fold each reduction
+// variable with its own operator ('s 은 s 합 ...'). Writes from functions it calls are checked
+// at runtime instead.
+void Parser::check_parallel_body(const ParallelNode* loop, const ASTNode* node, bool nested_loop) {
+    auto fail = [](const std::string& message) { throw std::runtime_error("Parser error: '몰몰' " + message); };
+    auto reduction = [&](std::string_view name) -> const Reduction* {
+        for (const Reduction* r = loop->reductions_begin(); r != loop->reductions_end(); ++r) {
+            if (r->var_name == name) return r;
+        }
+        return nullptr;
+    };
+    switch (node->kind) {
+    case NodeKind::RETURN: fail("body cannot use '퇴근'."); break;
+    case NodeKind::INPUT: fail("body cannot use '뭐먹'."); break;
+    case NodeKind::FUNC_DEF: fail("body cannot define functions."); break;
+    case NodeKind::VARIABLE:
+        if (reduction(static_cast<const VariableNode*>(node)->name)) {
+            fail("reduction '" + std::string(static_cast<const VariableNode*>(node)->name) + "' can only be updated.");
+        }
+        break;
+    case NodeKind::ASSIGN: {
+        const auto* assign_node = static_cast<const AssignNode*>(node);
+        if (assign_node->var_name == loop->index) fail("body cannot assign the loop variable.");
+        const Reduction* r = reduction(assign_node->var_name);
+        if (!r) break;
+        // s 은 s op a op b ...: the left spine must end in s, and no operand may read s again.
+        const ASTNode* expr = assign_node->expr;
+        while (const auto* binary_op_node = node_cast<BinaryOpNode>(expr)) {
+            if (binary_op_node->op != r->op || nested_loop) break;
+            check_parallel_body(loop, binary_op_node->right, nested_loop);
+            expr = binary_op_node->left;
+        }
+        const auto* var_node = node_cast<VariableNode>(expr);
+        if (!var_node || var_node->name != r->var_name || expr == assign_node->expr) {
+            fail("reduction '" + std::string(r->var_name) + "' can only be updated with '" + std::string(r->var_name) +
+                 " 은 " + std::string(r->var_name) + (r->op == "+" ? " 합" : " 곱") + " ...'.");
+        }
+        return;
+    }
+    case NodeKind::PARALLEL: {
+        const auto* inner = static_cast<const ParallelNode*>(node);
+        if (inner->index == loop->index) fail("body cannot assign the loop variable.");
+        for (const Reduction* r = inner->reductions_begin(); r != inner->reductions_end(); ++r) {
+            if (reduction(r->var_name)) fail("reduction '" + std::string(r->var_name) + "' can only be updated.");
+            if (r->var_name == loop->index) fail("body cannot assign the loop variable.");
+        }
+        if (reduction(inner->index)) fail("reduction '" + std::string(inner->index) + "' can only be updated.");
+        for_each_child(node, [&](const ASTNode* child) { check_parallel_body(loop, child, true); });
+        return;
+    }
+    default:
+        break;
+    }
+    for_each_child(node, [&](const ASTNode* child) { check_parallel_body(loop, child, nested_loop); });
 }
 
-std::vector<std::unique_ptr<ASTNode>> Parser::parse_block() {
+NodeList Parser::parse_block() {
     consume(); // '['
-    std::vector<std::unique_ptr<ASTNode>> statements;
+    std::vector<ASTNode*> statements;
     while (peek().value != "]") {
         statements.push_back(parse_statement());
     }
     consume(); // ']'
-    return statements;
+    return make_list(statements);
 }
 
-std::unique_ptr<ASTNode> Parser::parse_expression() {
+ASTNode* Parser::parse_expression() {
     auto left = parse_simple_expr();
     while (peek().type == TokenType::KEYWORD) {
-        std::string op_token = peek().value;
-        if (op_token == "은" || op_token == "입" || op_token == "몰" || op_token == "스크럼" || op_token == "캠프" || op_token == "퇴근") break;
+        std::string_view op_token = peek().value;
+        if (op_token == "은" || op_token == "입" || op_token == "몰" || op_token == "몰몰" || op_token == "스크럼" || op_token == "캠프" || op_token == "퇴근") break;
         if (peek().value == "[" || peek().value == "]") break;
         
         consume();
-        std::string op = get_operator(op_token);
+        std::string_view op = get_operator(op_token);
         auto right = parse_simple_expr();
-        left = std::make_unique<BinaryOpNode>(std::move(left), op, std::move(right));
+        left = arena.make<BinaryOpNode>(left, op, right);
     }
     return left;
 }
 
-std::unique_ptr<ASTNode> Parser::parse_simple_expr() {
+ASTNode* Parser::parse_simple_expr() {
     Token token = consume();
     if (token.type == TokenType::NUMBER) {
-        return std::make_unique<NumberNode>(token.value);
+        return arena.make<NumberNode>(token.number);
     }
     if (token.type == TokenType::STRING) {
-        return std::make_unique<StringNode>(token.value);
+        return arena.make<StringNode>(token.value);
     }
     if (token.type == TokenType::IDENTIFIER) {
-        return std::make_unique<VariableNode>(token.value);
+        return arena.make<VariableNode>(token.value);
     }
     if (token.value == "뭐먹") {
-        return std::make_unique<InputNode>();
-    }
-    if (token.value == "커서") return std::make_unique<StringNode>("커서는 신이야");
-    if (token.value == "지피티") return std::make_unique<StringNode>("지피티는 요즘 애매해");
-    if (token.value == "제미나이") return std::make_unique<StringNode>("제미나이는 잘 따라가는중");
-    if (token.value == "클로드") return std::make_unique<StringNode>("클로드는 LLM 중 코딩 끝판왕");
-    if (token.value == "클라인") return std::make_unique<StringNode>("클라인도 레전드입니다… 꼭 쓰세요");
-    if (token.value == "그록") return std::make_unique<StringNode>("그록 누가씀?");
+        return arena.make<InputNode>();
+    }
+    if (token.value == "커서") return arena.make<StringNode>("커서는 신이야");
+    if (token.value == "지피티") return arena.make<StringNode>("지피티는 요즘 애매해");
+    if (token.value == "제미나이") return arena.make<StringNode>("제미나이는 잘 따라가는중");
+    if (token.value == "클로드") return arena.make<StringNode>("클로드는 LLM 중 코딩 끝판왕");
+    if (token.value == "클라인") return arena.make<StringNode>("클라인도 레전드입니다… 꼭 쓰세요");
+    if (token.value == "그록") return arena.make<StringNode>("그록 누가씀?");
     
-    throw std::runtime_error("Invalid expression term: " + token.value);
+    throw std::runtime_error("Invalid expression term: " + std::string(token.value));
 }
 
-std::string Parser::get_operator(const std::string& token) {
+std::string_view Parser::get_operator(std::string_view token) {
     if (token == "덧셈" || token == "합" || token == "더하기") return "+";
     if (token == "곱셈" || token == "곱") return "*";
     if (token == "같") return "==";
     if (token == "작") return "<";
     if (token == "같작" || token == "작같") return "<=";
-    throw std::runtime_error("Unknown operator: " + token);
+    throw std::runtime_error("Unknown operator: " + std::string(token));
 }
 
 
-// --- Code Generator ---
-void collect_symbols(const ASTNode* node) {
-    if (!node) return;
-
-    if (const auto* assign_node = dynamic_cast<const AssignNode*>(node)) {
-        get_cpp_var(assign_node->var_name);
-        collect_symbols(assign_node->expr.get());
-    } else if (const auto* print_node = dynamic_cast<const PrintNode*>(node)) {
-        collect_symbols(print_node->expr.get());
-    } else if (const auto* if_node = dynamic_cast<const IfNode*>(node)) {
-        collect_symbols(if_node->condition.get());
-        for (const auto& stmt : if_node->body) {
-            collect_symbols(stmt.get());
-        }
-    } else if (const auto* while_node = dynamic_cast<const WhileNode*>(node)) {
-        collect_symbols(while_node->condition.get());
-        for (const auto& stmt : while_node->body) {
-            collect_symbols(stmt.get());
-        }
-    } else if (const auto* func_def_node = dynamic_cast<const FuncDefNode*>(node)) {
-        get_cpp_func(func_def_node->name);
-        for (const auto& stmt : func_def_node->body) {
-            collect_symbols(stmt.get());
-        }
-    } else if (const auto* func_call_node = dynamic_cast<const FuncCallNode*>(node)) {
-        get_cpp_func(func_call_node->name);
-    } else if (const auto* return_node = dynamic_cast<const ReturnNode*>(node)) {
-        collect_symbols(return_node->expr.get());
-    } else if (const auto* binary_op_node = dynamic_cast<const BinaryOpNode*>(node)) {
-        collect_symbols(binary_op_node->left.get());
-        collect_symbols(binary_op_node->right.get());
-    } else if (const auto* var_node = dynamic_cast<const VariableNode*>(node)) {
-        get_cpp_var(var_node->name);
-    }
-}
-
-std::string generate_cpp_code(const std::vector<std::unique_ptr<ASTNode>>& ast) {
-    std::stringstream ss;
-
-    // Preamble
-    ss << R"(#include <iostream>
-#include <string>
-#include <vector>
-#include <variant>
-#include <stdexcept>
-
-// A variant type to handle Mollang's dynamic types
-struct MolObject {
-    std::variant<std::monostate, int, std::string, bool> value;
-
-    MolObject() : value(std::monostate{}) {}
-    MolObject(int v) : value(v) {}
-    MolObject(const std::string& v) : value(v) {}
-    MolObject(const char* v) : value(std::string(v)) {}
-    MolObject(bool v) : value(v) {}
-};
-
-// Overloads for operators
-MolObject operator+(const MolObject& a, const MolObject& b) {
-    if (std::holds_alternative<int>(a.value) && std::holds_alternative<int>(b.value)) {
-        return MolObject(std::get<int>(a.value) + std::get<int>(b.value));
-    }
-    if (std::holds_alternative<std::string>(a.value) && std::holds_alternative<std::string>(b.value)) {
-        return MolObject(std::get<std::string>(a.value) + std::get<std::string>(b.value));
+// --- Type Inference ---
+// Result types of a binary operator for every operand combination the runtime accepts natively.
+// Any other combination throws at runtime, except '==' which compares as false.
+TypeSet binary_result_type(std::string_view op, TypeSet l, TypeSet r) {
+    if (op == "+") {
+        if (l == TYPE_INT && r == TYPE_INT) return TYPE_INT;
+        if (l == TYPE_STRING && r == TYPE_STRING) return TYPE_STRING;
+    } else if (op == "*") {
+        if (l == TYPE_STRING && r == TYPE_INT) return TYPE_STRING;
+        if (l == TYPE_INT && r == TYPE_INT) return TYPE_INT;
+    } else if (op == "<" || op == "<=") {
+        if (l == TYPE_INT && r == TYPE_INT) return TYPE_BOOL;
+    } else if (op == "==") {
+        if ((l == TYPE_INT && r == TYPE_INT) || (l == TYPE_STRING && r == TYPE_STRING)) return TYPE_BOOL;
     }
-    throw std::runtime_error("Unsupported operand types for +");
+    return 0;
 }
 
-MolObject operator*(const MolObject& a, const MolObject& b) {
-    if (std::holds_alternative<std::string>(a.value) && std::holds_alternative<int>(b.value)) {
-        std::string s = "";
-        for (int i = 0; i < std::get<int>(b.value); ++i) {
-            s += std::get<std::string>(a.value);
+TypeSet binary_type(std::string_view op, TypeSet l, TypeSet r) {
+    TypeSet result = 0;
+    for (TypeSet lt = TYPE_NONE; lt <= TYPE_BOOL; lt <<= 1) {
+        if (!(l & lt)) continue;
+        for (TypeSet rt = TYPE_NONE; rt <= TYPE_BOOL; rt <<= 1) {
+            if (!(r & rt)) continue;
+            TypeSet t = binary_result_type(op, lt, rt);
+            result |= (t == 0 && op == "==") ? TYPE_BOOL : t;
         }
-        return MolObject(s);
-    }
-    if (std::holds_alternative<int>(a.value) && std::holds_alternative<int>(b.value)) {
-        return MolObject(std::get<int>(a.value) * std::get<int>(b.value));
     }
-    throw std::runtime_error("Unsupported operand types for *");
+    return result;
 }
 
-MolObject operator<(const MolObject& a, const MolObject& b) {
-    if (std::holds_alternative<int>(a.value) && std::holds_alternative<int>(b.value)) {
-        return MolObject(std::get<int>(a.value) < std::get<int>(b.value));
+TypeSet expr_type(const CompilationContext& ctx, const ASTNode* node) {
+    switch (node->kind) {
+    case NodeKind::NUMBER: return TYPE_INT;
+    case NodeKind::STRING: return TYPE_STRING;
+    case NodeKind::BOOL: return TYPE_BOOL;
+    case NodeKind::INPUT: return TYPE_INT | TYPE_STRING;
+    case NodeKind::VARIABLE: return ctx.variable_type(static_cast<const VariableNode*>(node)->name);
+    case NodeKind::BINARY_OP: {
+        const auto* binary_op_node = static_cast<const BinaryOpNode*>(node);
+        return binary_type(binary_op_node->op, expr_type(ctx, binary_op_node->left), expr_type(ctx, binary_op_node->right));
+    }
+    default:
+        return 0;
     }
-    throw std::runtime_error("Unsupported operand types for <");
 }
 
-MolObject operator<=(const MolObject& a, const MolObject& b) {
-    if (std::holds_alternative<int>(a.value) && std::holds_alternative<int>(b.value)) {
-        return MolObject(std::get<int>(a.value) <= std::get<int>(b.value));
+void collect_function_defs(const ASTNode* node, std::map<std::string_view, const FuncDefNode*>& defs) {
+    if (const auto* func_def_node = node_cast<FuncDefNode>(node)) {
+        defs.emplace(func_def_node->name, func_def_node);
     }
-    throw std::runtime_error("Unsupported operand types for <=");
+    for_each_child(node, [&](const ASTNode* child) { collect_function_defs(child, defs); });
 }
 
-MolObject operator==(const MolObject& a, const MolObject& b) {
-    if (std::holds_alternative<int>(a.value) && std::holds_alternative<int>(b.value)) {
-        return MolObject(std::get<int>(a.value) == std::get<int>(b.value));
+// Widens the type of every assigned variable until no assignment can add a new type.
+void infer_assigned_types(CompilationContext& ctx, const ASTNode* node, bool& changed) {
+    if (const auto* assign_node = node_cast<AssignNode>(node)) {
+        TypeSet t = expr_type(ctx, assign_node->expr);
+        TypeSet& current = ctx.variable_types[std::string(assign_node->var_name)];
+        if ((current | t) != current) {
+            current |= t;
+            changed = true;
+        }
+        return;
     }
-    if (std::holds_alternative<std::string>(a.value) && std::holds_alternative<std::string>(b.value)) {
-        return MolObject(std::get<std::string>(a.value) == std::get<std::string>(b.value));
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        TypeSet& current = ctx.variable_types[std::string(parallel_node->index)];
+        if (!(current & TYPE_INT)) {
+            current |= TYPE_INT;
+            changed = true;
+        }
     }
-    return MolObject(false);
+    for_each_child(node, [&](const ASTNode* child) { infer_assigned_types(ctx, child, changed); });
 }
 
-// Helper functions
-void mollang_print(const MolObject& obj) {
-    if (std::holds_alternative<int>(obj.value)) {
-        std::cout << std::get<int>(obj.value);
-    } else if (std::holds_alternative<std::string>(obj.value)) {
-        std::cout << std::get<std::string>(obj.value);
-    } else if (std::holds_alternative<bool>(obj.value)) {
-        std::cout << (std::get<bool>(obj.value) ? "true" : "false");
-    }
-    std::cout << std::endl;
+bool contains_return(const ASTNode* node) {
+    if (node->kind == NodeKind::RETURN) return true;
+    if (node->kind != NodeKind::IF && node->kind != NodeKind::WHILE) return false;
+    bool found = false;
+    for_each_child(node, [&](const ASTNode* child) { found = found || contains_return(child); });
+    return found;
 }
 
-MolObject mollang_input() {
-    std::string line;
-    std::getline(std::cin, line);
-    try {
-        return MolObject(std::stoi(line));
-    } catch (const std::invalid_argument&) {
-        return MolObject(line);
-    }
-}
-)";
+// Definite-assignment analysis: finds variables that may be read while still holding
+// std::monostate and adds TYPE_NONE to them. Function bodies are analyzed with the
+// intersection of the assigned sets at all of their call sites.
+struct InitAnalysis {
+    explicit InitAnalysis(CompilationContext& ctx) : ctx(ctx) {}
 
-    // Function Prototypes
-    for (const auto& pair : function_map) {
-        ss << "MolObject " << pair.second << "();\n";
+    CompilationContext& ctx;
+    std::map<std::string_view, const FuncDefNode*> defs;
+    std::map<std::string_view, std::set<std::string_view>> entry;      // from the previous round
+    std::map<std::string_view, std::set<std::string_view>> call_sites; // collected in this round
+
+    // Variables a function assigns on every path before it can return.
+    std::set<std::string_view> must_assign(std::string_view func) const {
+        std::set<std::string_view> assigned;
+        auto it = defs.find(func);
+        if (it == defs.end()) return assigned;
+        for (const ASTNode* stmt : it->second->body) {
+            if (contains_return(stmt)) break;
+            if (const auto* assign_node = node_cast<AssignNode>(stmt)) {
+                assigned.insert(assign_node->var_name);
+            }
+        }
+        return assigned;
     }
-    ss << "\n";
 
-    // Global Variables
-    for (const auto& pair : variable_map) {
-        ss << "MolObject " << pair.second << ";\n";
+    void check_expr(const ASTNode* node, const std::set<std::string_view>& assigned) {
+        if (const auto* var_node = node_cast<VariableNode>(node)) {
+            if (!assigned.count(var_node->name)) ctx.variable_types[std::string(var_node->name)] |= TYPE_NONE;
+            return;
+        }
+        for_each_child(node, [&](const ASTNode* child) { check_expr(child, assigned); });
     }
-    ss << "\n";
 
-    // Function Definitions
-    for (const auto& node : ast) {
-        if (dynamic_cast<const FuncDefNode*>(node.get())) {
-            ss << node->generate() << "\n\n";
+    void check_call(const FuncCallNode* call, std::set<std::string_view>& assigned) {
+        auto it = call_sites.find(call->name);
+        if (it == call_sites.end()) {
+            call_sites.emplace(call->name, assigned);
+        } else {
+            std::set<std::string_view> common;
+            for (const auto& var : it->second) {
+                if (assigned.count(var)) common.insert(var);
+            }
+            it->second = std::move(common);
         }
+        for (const auto& var : must_assign(call->name)) assigned.insert(var);
     }
 
-    // Main function
-    ss << "int main() {\n";
-    for (const auto& node : ast) {
-        if (!dynamic_cast<const FuncDefNode*>(node.get())) {
-            ss << "    " << node->generate() << "\n";
+    void check_body(const NodeList& body, std::set<std::string_view> assigned) {
+        for (const ASTNode* node : body) {
+            switch (node->kind) {
+            case NodeKind::ASSIGN: {
+                const auto* assign_node = static_cast<const AssignNode*>(node);
+                check_expr(assign_node->expr, assigned);
+                assigned.insert(assign_node->var_name);
+                break;
+            }
+            case NodeKind::PRINT: check_expr(static_cast<const PrintNode*>(node)->expr, assigned); break;
+            case NodeKind::RETURN: check_expr(static_cast<const ReturnNode*>(node)->expr, assigned); break;
+            case NodeKind::IF: {
+                const auto* if_node = static_cast<const IfNode*>(node);
+                check_expr(if_node->condition, assigned);
+                check_body(if_node->body, assigned);
+                break;
+            }
+            case NodeKind::WHILE: {
+                const auto* while_node = static_cast<const WhileNode*>(node);
+                check_expr(while_node->condition, assigned);
+                check_body(while_node->body, assigned);
+                break;
+            }
+            case NodeKind::PARALLEL: {
+                // Reductions are read before the loop. Every iteration starts with the index and
+                // the reductions assigned and the body's own variables not, and none of the
+                // body's assignments are visible after the loop.
+                const auto* parallel_node = static_cast<const ParallelNode*>(node);
+                check_expr(parallel_node->begin, assigned);
+                check_expr(parallel_node->end, assigned);
+                std::set<std::string_view> inner = assigned;
+                for (std::string_view var : iteration_private_vars(parallel_node)) inner.erase(var);
+                inner.insert(parallel_node->index);
+                for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+                    if (!assigned.count(r->var_name)) ctx.variable_types[std::string(r->var_name)] |= TYPE_NONE;
+                    inner.insert(r->var_name);
+                }
+                check_body(parallel_node->body, inner);
+                break;
+            }
+            case NodeKind::FUNC_CALL: check_call(static_cast<const FuncCallNode*>(node), assigned); break;
+            default: break;
+            }
         }
     }
-    ss << "    return 0;\n";
-    ss << "}\n";
 
-    return ss.str();
-}
+    void run(const NodeList& ast) {
+        for (const ASTNode* node : ast) collect_function_defs(node, defs);
+        // Entry sets only shrink from round to round, so this terminates.
+        do {
+            call_sites.clear();
+            check_body(ast, {});
+            for (const auto& pair : entry) {
+                auto it = defs.find(pair.first);
+                if (it != defs.end()) check_body(it->second->body, pair.second);
+            }
+            std::swap(entry, call_sites);
+        } while (entry != call_sites);
+    }
+};
 
+void annotate_binary_op(BinaryOpNode* node) {
+    const ASTNode* l = node->left;
+    const ASTNode* r = node->right;
+    node->type = binary_type(node->op, l->type, r->type);
+    node->native = l->native && r->native && binary_result_type(node->op, l->type, r->type) != 0;
+}
 
-// --- Main Compiler Logic ---
-std::string translate_to_cpp(const std::string& mollang_code) {
-    // Reset global state for each compilation
-    variable_map.clear();
-    var_counter = 0;
-    function_map.clear();
-    func_counter = 0;
+// Annotates expression nodes with their final type and whether they can be emitted natively.
+void annotate_types(const CompilationContext& ctx, ASTNode* node) {
+    for_each_child(node, [&](ASTNode* child) { annotate_types(ctx, child); });
+    switch (node->kind) {
+    case NodeKind::BINARY_OP:
+        annotate_binary_op(static_cast<BinaryOpNode*>(node));
+        break;
+    case NodeKind::NUMBER:
+    case NodeKind::STRING:
+    case NodeKind::BOOL:
+    case NodeKind::VARIABLE:
+        node->type = expr_type(ctx, node);
+        node->native = is_single_type(node->type);
+        break;
+    case NodeKind::INPUT:
+        node->type = expr_type(ctx, node);
+        break;
+    default:
+        break;
+    }
+}
 
-    auto tokens = tokenize(mollang_code);
-    Parser parser(std::move(tokens));
-    auto ast = parser.parse();
+void collect_return_types(const NodeList& body, TypeSet& types) {
+    for (const ASTNode* stmt : body) {
+        if (const auto* return_node = node_cast<ReturnNode>(stmt)) {
+            // An expression without a type always throws; the function keeps returning MolObject.
+            types |= return_node->expr->type ? return_node->expr->type : TYPE_NONE;
+        }
+        if (const auto* if_node = node_cast<IfNode>(stmt)) collect_return_types(if_node->body, types);
+        if (const auto* while_node = node_cast<WhileNode>(stmt)) collect_return_types(while_node->body, types);
+    }
+}
 
-    // Populate symbol maps
-    for (const auto& node : ast) {
-        collect_symbols(node.get());
+// A function's return type is the union of what its '퇴근' statements return, plus TYPE_NONE
+// if it can also end without one. A function with a single native return type returns it
+// unboxed.
+void infer_return_types(CompilationContext& ctx, const NodeList& ast) {
+    ctx.function_return_types.clear();
+    for (const ASTNode* node : ast) {
+        const auto* func_def_node = node_cast<FuncDefNode>(node);
+        if (!func_def_node) continue;
+        TypeSet& types = ctx.function_return_types[std::string(func_def_node->name)];
+        collect_return_types(func_def_node->body, types);
+        const NodeList& body = func_def_node->body;
+        if (types != 0 && (body.size() == 0 || body.items[body.size() - 1]->kind != NodeKind::RETURN)) {
+            types |= TYPE_NONE;
+        }
     }
+}
 
-    return generate_cpp_code(ast);
+// The types every variable may be assigned, without annotating the tree.
+void infer_variable_types(CompilationContext& ctx, const NodeList& ast) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const ASTNode* node : ast) {
+            infer_assigned_types(ctx, node, changed);
+        }
+    }
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "사용법: " << argv[0] << " <입력_파일.mol>" << std::endl;
-        return 1;
+void infer_types(CompilationContext& ctx, NodeList& ast) {
+    infer_variable_types(ctx, ast);
+    InitAnalysis(ctx).run(ast);
+    for (ASTNode* node : ast) {
+        annotate_types(ctx, node);
     }
+    infer_return_types(ctx, ast);
+}
 
-    std::string input_filename = argv[1];
-    if (input_filename.size() <= 4 || input_filename.substr(input_filename.size() - 4) != ".mol") {
-        std::cerr << "오류: 입력 파일은 '.mol' 확장자여야 합니다." << std::endl;
-        return 1;
+void collect_product_reductions(const ASTNode* node, std::vector<std::string_view>& names) {
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+            if (r->op == "*") names.push_back(r->var_name);
+        }
     }
+    for_each_child(node, [&](const ASTNode* child) { collect_product_reductions(child, names); });
+}
 
-    std::ifstream input_file(input_filename);
-    if (!input_file) {
-        std::cerr << "오류: '" << input_filename << "' 파일을 열 수 없습니다." << std::endl;
-        return 1;
+// Chunks of a '몰몰' loop fold their '곱' reductions as products of ints. Repeating a string
+// by one factor after another cannot be regrouped that way, so a '곱' reduction on a variable
+// that may hold a string is an error. `types` holds the inferred variable types, or is null
+// to infer them here.
+void check_reductions(const NodeList& ast, const CompilationContext* types) {
+    std::vector<std::string_view> names;
+    for (const ASTNode* node : ast) collect_product_reductions(node, names);
+    if (names.empty()) return;
+    CompilationContext inferred;
+    if (!types) {
+        infer_variable_types(inferred, ast);
+        types = &inferred;
+    }
+    for (std::string_view name : names) {
+        if (types->variable_type(name) & TYPE_STRING) {
+            throw std::runtime_error("Parser error: '몰몰' reduction '" + std::string(name) +
+                                     "' may hold a string, so it cannot be folded with '곱'.");
+        }
     }
+}
 
+
+// --- Optimizer ---
+// Optimization levels selected on the command line with -O0 / -O1.
+const int OPT_NONE = 0;
+const int OPT_BASIC = 1; // constant folding and propagation, dead-code elimination
+
+// Command-line settings that change the generated program. All of them are part of the build
+// cache key.
+// g++ flags for the generated program (--build=<name>). The runtime library and its
+// precompiled header are built once per profile, because a PCH is only used by compiles
+// with matching flags.
+enum class BuildProfile { DEBUG, RELEASE, NATIVE, SIZE };
+
+struct BuildProfileFlags {
+    const char* name;
+    const char* compile; // also used for the runtime library
+    const char* link;
+};
+
+const BuildProfileFlags BUILD_PROFILES[] = {
+    {"debug", "-O0 -g", ""},
+    {"release", "-O2", ""},
+    {"native", "-O3 -march=native -flto", "-flto"},
+    {"size", "-Os", "-s"},
+};
+
+const BuildProfileFlags& build_flags(BuildProfile profile) {
+    return BUILD_PROFILES[static_cast<int>(profile)];
+}
+
+bool parse_build_profile(std::string_view name, BuildProfile& profile) {
+    for (size_t i = 0; i < std::size(BUILD_PROFILES); ++i) {
+        if (name == BUILD_PROFILES[i].name) {
+            profile = static_cast<BuildProfile>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// What the generated C++ is compiled into: a native executable with g++, or a WebAssembly
+// module and its JavaScript loader with Emscripten's em++ (--target=wasm).
+enum class Target { NATIVE, WASM };
+
+struct CompileOptions {
+    int opt_level = OPT_BASIC;
+    bool line_buffered = false; // flush stdout after every '스크럼' instead of at exit/reads
+    bool profile = false;       // count and time every '몰', '입' and '캠프' (--profile)
+    BuildProfile build = BuildProfile::RELEASE;
+    bool static_link = false;   // --static
+    std::string pgo_training;   // stdin of the --pgo training run, empty without PGO
+    bool incremental = false;   // one translation unit and object file per function
+    Target target = Target::NATIVE;
+
+    // The training input's contents are part of the cache key, see build_cache_key().
+    std::string cache_tag() const {
+        return "O" + std::to_string(opt_level) + (line_buffered ? " line-buffered" : "") +
+               (profile ? " profile" : "") + " build=" + build_flags(build).name + (static_link ? " static" : "") +
+               (pgo_training.empty() ? "" : " pgo") + (incremental ? " incremental" : "") +
+               (target == Target::WASM ? " wasm" : "");
+    }
+};
+
+// Folded strings are emitted verbatim at every use, so keep them small.
+const size_t MAX_FOLDED_STRING = 1024;
+// Largest function body, in AST nodes, that is copied into its call sites.
+const size_t MAX_INLINE_NODES = 32;
+
+bool is_literal(const ASTNode* node) {
+    return node->kind == NodeKind::NUMBER || node->kind == NodeKind::STRING || node->kind == NodeKind::BOOL;
+}
+
+bool defines_function(const ASTNode* node) {
+    if (node->kind == NodeKind::FUNC_DEF) return true;
+    bool found = false;
+    for_each_child(node, [&](const ASTNode* child) { found = found || defines_function(child); });
+    return found;
+}
+
+void count_assignments(const ASTNode* node, std::map<std::string_view, int>& counts,
+                       std::map<std::string_view, const ASTNode*>& values) {
+    if (const auto* assign_node = node_cast<AssignNode>(node)) {
+        counts[assign_node->var_name]++;
+        values[assign_node->var_name] = assign_node->expr;
+    }
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        // The loop assigns its index, and the reductions when it ends.
+        counts[parallel_node->index]++;
+        values[parallel_node->index] = node;
+        for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+            counts[r->var_name]++;
+            values[r->var_name] = node;
+        }
+    }
+    for_each_child(node, [&](const ASTNode* child) { count_assignments(child, counts, values); });
+}
+
+size_t count_nodes(const ASTNode* node) {
+    size_t count = 1;
+    for_each_child(node, [&](const ASTNode* child) { count += count_nodes(child); });
+    return count;
+}
+
+void collect_calls(const ASTNode* node, std::set<std::string_view>& calls) {
+    if (const auto* call_node = node_cast<FuncCallNode>(node)) calls.insert(call_node->name);
+    for_each_child(node, [&](const ASTNode* child) { collect_calls(child, calls); });
+}
+
+// Call graph over function names; the key MAIN_FUNCTION stands for the top-level statements.
+using CallGraph = std::map<std::string_view, std::set<std::string_view>>;
+constexpr std::string_view MAIN_FUNCTION = "";
+
+// True if `function` can reach itself through the calls in `graph`.
+bool calls_itself(const CallGraph& graph, std::string_view function) {
+    std::set<std::string_view> seen;
+    std::vector<std::string_view> pending{function};
+    while (!pending.empty()) {
+        auto it = graph.find(pending.back());
+        pending.pop_back();
+        if (it == graph.end()) continue;
+        for (std::string_view callee : it->second) {
+            if (callee == function) return true;
+            if (seen.insert(callee).second) pending.push_back(callee);
+        }
+    }
+    return false;
+}
+
+void collect_parallel_calls(const ASTNode* node, std::set<std::string_view>& calls) {
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        for (const ASTNode* stmt : parallel_node->body) collect_calls(stmt, calls);
+        return;
+    }
+    for_each_child(node, [&](const ASTNode* child) { collect_parallel_calls(child, calls); });
+}
+
+// The functions that may run on a '몰몰' worker thread: everything reachable from a loop body.
+// Their writes to globals are checked at runtime.
+std::set<std::string_view> parallel_callees(const NodeList& ast) {
+    CallGraph graph;
+    std::set<std::string_view> reached;
+    for (const ASTNode* node : ast) {
+        if (const auto* func_def_node = node_cast<FuncDefNode>(node)) {
+            for (const ASTNode* stmt : func_def_node->body) collect_calls(stmt, graph[func_def_node->name]);
+        }
+        collect_parallel_calls(node, reached);
+    }
+    std::vector<std::string_view> pending(reached.begin(), reached.end());
+    while (!pending.empty()) {
+        auto it = graph.find(pending.back());
+        pending.pop_back();
+        if (it == graph.end()) continue;
+        for (std::string_view callee : it->second) {
+            if (reached.insert(callee).second) pending.push_back(callee);
+        }
+    }
+    return reached;
+}
+
+// Rewrites the AST in place. Every rewrite keeps runtime behaviour, including runtime errors:
+// operations the runtime rejects are never folded, and code that defines a function is never
+// removed or moved because that changes whether the program compiles. Assignments in
+// functions a '몰몰' body may call are kept too, since they are checked shared writes.
+class Optimizer {
+public:
+    explicit Optimizer(Arena& arena) : arena(arena) {}
+
+    void run(NodeList& ast) {
+        // Propagated constants turn into new folding opportunities, so repeat until stable.
+        do {
+            changed = false;
+            ast = simplify_body(ast);
+            find_constants(ast);
+        } while (changed || !constants.empty());
+    }
+
+private:
+    Arena& arena;
+    bool changed = false;
+    // Variables whose every read sees one literal value, found by the previous round.
+    std::map<std::string_view, const ASTNode*> constants;
+
+    ASTNode* clone_literal(const ASTNode* node) {
+        switch (node->kind) {
+        case NodeKind::NUMBER: return arena.make<NumberNode>(static_cast<const NumberNode*>(node)->value);
+        case NodeKind::STRING: return arena.make<StringNode>(static_cast<const StringNode*>(node)->value);
+        default: return arena.make<BoolNode>(static_cast<const BoolNode*>(node)->value);
+        }
+    }
+
+    // A variable assigned exactly once with a literal can be replaced by that literal when the
+    // definite-assignment analysis proves it is never read before the assignment, unless the
+    // assignment is in a function a '몰몰' body may call.
+    void find_constants(NodeList& ast) {
+        constants.clear();
+        std::map<std::string_view, int> counts;
+        std::map<std::string_view, const ASTNode*> values;
+        for (const ASTNode* node : ast) count_assignments(node, counts, values);
+        std::set<std::string_view> checked = parallel_callees(ast);
+        std::map<std::string_view, int> checked_counts;
+        std::map<std::string_view, const ASTNode*> checked_values;
+        for (const ASTNode* node : ast) {
+            const auto* func_def_node = node_cast<FuncDefNode>(node);
+            if (func_def_node && checked.count(func_def_node->name)) {
+                count_assignments(node, checked_counts, checked_values);
+            }
+        }
+
+        // Types are inferred into a scratch context; the final pass runs on the optimized tree.
+        CompilationContext types;
+        infer_types(types, ast);
+        for (const auto& pair : counts) {
+            const ASTNode* value = values[pair.first];
+            if (pair.second != 1 || !is_literal(value) || (types.variable_type(pair.first) & TYPE_NONE) ||
+                checked_counts.count(pair.first)) {
+                continue;
+            }
+            if (const auto* string_node = node_cast<StringNode>(value)) {
+                if (string_node->value.size() > MAX_FOLDED_STRING) continue;
+            }
+            constants.emplace(pair.first, value);
+        }
+    }
+
+    // The literal a binary operation on two literals evaluates to, or nullptr if it has to be
+    // left to the runtime (unsupported operands, int overflow, oversized strings).
+    ASTNode* fold_binary(const BinaryOpNode* node) {
+        const auto* li = node_cast<NumberNode>(node->left);
+        const auto* ri = node_cast<NumberNode>(node->right);
+        const auto* ls = node_cast<StringNode>(node->left);
+        const auto* rs = node_cast<StringNode>(node->right);
+        std::string_view op = node->op;
+
+        if (op == "==") {
+            if (li && ri) return arena.make<BoolNode>(li->value == ri->value);
+            if (ls && rs) return arena.make<BoolNode>(ls->value == rs->value);
+            return arena.make<BoolNode>(false); // the runtime compares any other pair as false
+        }
+        if (li && ri) {
+            long long l = li->value;
+            long long r = ri->value;
+            if (op == "<") return arena.make<BoolNode>(l < r);
+            if (op == "<=") return arena.make<BoolNode>(l <= r);
+            long long result = op == "+" ? l + r : l * r;
+            if (result < std::numeric_limits<int>::min() || result > std::numeric_limits<int>::max()) return nullptr;
+            return arena.make<NumberNode>(static_cast<int>(result));
+        }
+        if (op == "+" && ls && rs) {
+            // Literal values are raw text that write_string_literal() escapes, so joining two
+            // is exact even when a backslash ends up next to the other literal's first byte.
+            if (ls->value.size() + rs->value.size() > MAX_FOLDED_STRING) return nullptr;
+            return arena.make<StringNode>(arena.copy(std::string(ls->value) + std::string(rs->value)));
+        }
+        if (op == "*" && ls && ri) {
+            size_t count = ri->value > 0 ? static_cast<size_t>(ri->value) : 0;
+            if (count > 0 && ls->value.size() > MAX_FOLDED_STRING / count) return nullptr;
+            return arena.make<StringNode>(arena.copy(mollang_repeat(ls->value, ri->value)));
+        }
+        return nullptr;
+    }
+
+    ASTNode* fold(ASTNode* expr) {
+        if (const auto* var_node = node_cast<VariableNode>(expr)) {
+            auto it = constants.find(var_node->name);
+            if (it == constants.end()) return expr;
+            changed = true;
+            return clone_literal(it->second);
+        }
+        auto* binary_op_node = node_cast<BinaryOpNode>(expr);
+        if (!binary_op_node) return expr;
+        binary_op_node->left = fold(binary_op_node->left);
+        binary_op_node->right = fold(binary_op_node->right);
+        if (!is_literal(binary_op_node->left) || !is_literal(binary_op_node->right)) return expr;
+        ASTNode* folded = fold_binary(binary_op_node);
+        if (!folded) return expr;
+        changed = true;
+        return folded;
+    }
+
+    NodeList simplify_body(const NodeList& body) {
+        std::vector<ASTNode*> statements;
+        bool returned = false;
+        for (ASTNode* stmt : body) {
+            if (returned) {
+                // Unreachable, but function definitions are hoisted and stay callable.
+                if (stmt->kind == NodeKind::FUNC_DEF) {
+                    static_cast<FuncDefNode*>(stmt)->body = simplify_body(static_cast<FuncDefNode*>(stmt)->body);
+                    statements.push_back(stmt);
+                } else {
+                    changed = true;
+                }
+                continue;
+            }
+            switch (stmt->kind) {
+            case NodeKind::ASSIGN: {
+                auto* assign_node = static_cast<AssignNode*>(stmt);
+                if (constants.count(assign_node->var_name)) {
+                    changed = true; // every read has been replaced by the value
+                    continue;
+                }
+                assign_node->expr = fold(assign_node->expr);
+                break;
+            }
+            case NodeKind::PRINT: {
+                auto* print_node = static_cast<PrintNode*>(stmt);
+                print_node->expr = fold(print_node->expr);
+                break;
+            }
+            case NodeKind::RETURN: {
+                auto* return_node = static_cast<ReturnNode*>(stmt);
+                return_node->expr = fold(return_node->expr);
+                returned = true;
+                break;
+            }
+            case NodeKind::IF: {
+                auto* if_node = static_cast<IfNode*>(stmt);
+                if_node->condition = fold(if_node->condition);
+                if_node->body = simplify_body(if_node->body);
+                const auto* cond = node_cast<BoolNode>(if_node->condition);
+                if (cond && !defines_function(stmt)) {
+                    changed = true;
+                    if (cond->value) {
+                        for (ASTNode* inner : if_node->body) {
+                            statements.push_back(inner);
+                            returned = returned || inner->kind == NodeKind::RETURN;
+                        }
+                    }
+                    continue;
+                }
+                break;
+            }
+            case NodeKind::WHILE: {
+                auto* while_node = static_cast<WhileNode*>(stmt);
+                while_node->condition = fold(while_node->condition);
+                while_node->body = simplify_body(while_node->body);
+                const auto* cond = node_cast<BoolNode>(while_node->condition);
+                if (cond && !cond->value && !defines_function(stmt)) {
+                    changed = true;
+                    continue;
+                }
+                break;
+            }
+            case NodeKind::PARALLEL: {
+                auto* parallel_node = static_cast<ParallelNode*>(stmt);
+                parallel_node->begin = fold(parallel_node->begin);
+                parallel_node->end = fold(parallel_node->end);
+                parallel_node->body = simplify_body(parallel_node->body);
+                break;
+            }
+            case NodeKind::FUNC_DEF: {
+                auto* func_def_node = static_cast<FuncDefNode*>(stmt);
+                func_def_node->body = simplify_body(func_def_node->body);
+                break;
+            }
+            default:
+                break;
+            }
+            statements.push_back(stmt);
+        }
+        if (statements.size() == body.size() && std::equal(statements.begin(), statements.end(), body.begin())) {
+            return body;
+        }
+        return NodeList{arena.copy_array(statements), statements.size()};
+    }
+};
+
+
+// Replaces calls to small non-recursive functions with a copy of their body. Every variable
+// is global and a call's result is always discarded, so the copy behaves exactly like the
+// call without its overhead, and later folding can specialize it for each call site.
+// Definitions no call refers to anymore are removed. Calls in a '몰몰' body stay calls: a
+// copied assignment would become private to the iteration instead of a checked shared write.
+class Inliner {
+public:
+    explicit Inliner(Arena& arena) : arena(arena) {}
+
+    void run(NodeList& ast) {
+        for (ASTNode* node : ast) {
+            auto* func_def_node = node_cast<FuncDefNode>(node);
+            // Nested and repeated definitions are errors the program must still report.
+            if (!func_def_node) {
+                if (defines_function(node)) return;
+                continue;
+            }
+            for (const ASTNode* stmt : func_def_node->body) {
+                if (defines_function(stmt)) return;
+            }
+            if (!defs.emplace(func_def_node->name, func_def_node).second) return;
+        }
+        for (const auto& pair : defs) {
+            for (const ASTNode* stmt : pair.second->body) collect_calls(stmt, graph[pair.first]);
+        }
+        for (const auto& pair : defs) inline_into(pair.first);
+        ast = inline_calls(ast);
+        remove_uncalled(ast);
+    }
+
+private:
+    enum class State { PENDING, IN_PROGRESS, DONE };
+
+    Arena& arena;
+    std::map<std::string_view, FuncDefNode*> defs;
+    CallGraph graph;
+    std::map<std::string_view, State> states;
+    std::set<std::string_view> inlinable;
+
+    // A function can be inlined if only its last statement returns and what it returns can
+    // be dropped without losing a side effect or a runtime error.
+    bool can_inline(const FuncDefNode* node) const {
+        size_t size = 0;
+        for (size_t i = 0; i < node->body.size(); ++i) {
+            const ASTNode* stmt = node->body.items[i];
+            size += count_nodes(stmt);
+            if (!contains_return(stmt)) continue;
+            const auto* return_node = node_cast<ReturnNode>(stmt);
+            if (i + 1 != node->body.size() || !return_node) return false;
+            if (!is_literal(return_node->expr) && return_node->expr->kind != NodeKind::VARIABLE) return false;
+        }
+        return size <= MAX_INLINE_NODES;
+    }
+
+    // Inlines into `name` after its callees, so a body is copied with its own calls expanded.
+    void inline_into(std::string_view name) {
+        State& state = states[name];
+        if (state != State::PENDING) return;
+        state = State::IN_PROGRESS;
+        for (std::string_view callee : graph[name]) {
+            if (defs.count(callee)) inline_into(callee);
+        }
+        FuncDefNode* def = defs.at(name);
+        def->body = inline_calls(def->body);
+        states[name] = State::DONE;
+        if (!calls_itself(graph, name) && can_inline(def)) inlinable.insert(name);
+    }
+
+    // Copies keep the original source position.
+    ASTNode* clone(const ASTNode* node) {
+        ASTNode* copy = clone_node(node);
+        copy->line = node->line;
+        copy->column = node->column;
+        return copy;
+    }
+
+    ASTNode* clone_node(const ASTNode* node) {
+        switch (node->kind) {
+        case NodeKind::NUMBER: return arena.make<NumberNode>(static_cast<const NumberNode*>(node)->value);
+        case NodeKind::STRING: return arena.make<StringNode>(static_cast<const StringNode*>(node)->value);
+        case NodeKind::BOOL: return arena.make<BoolNode>(static_cast<const BoolNode*>(node)->value);
+        case NodeKind::VARIABLE: return arena.make<VariableNode>(static_cast<const VariableNode*>(node)->name);
+        case NodeKind::INPUT: return arena.make<InputNode>();
+        case NodeKind::BINARY_OP: {
+            const auto* binary_op_node = static_cast<const BinaryOpNode*>(node);
+            return arena.make<BinaryOpNode>(clone(binary_op_node->left), binary_op_node->op, clone(binary_op_node->right));
+        }
+        case NodeKind::ASSIGN: {
+            const auto* assign_node = static_cast<const AssignNode*>(node);
+            return arena.make<AssignNode>(assign_node->var_name, clone(assign_node->expr));
+        }
+        case NodeKind::PRINT: return arena.make<PrintNode>(clone(static_cast<const PrintNode*>(node)->expr));
+        case NodeKind::IF: {
+            const auto* if_node = static_cast<const IfNode*>(node);
+            return arena.make<IfNode>(clone(if_node->condition), clone_list(if_node->body));
+        }
+        case NodeKind::WHILE: {
+            const auto* while_node = static_cast<const WhileNode*>(node);
+            return arena.make<WhileNode>(clone(while_node->condition), clone_list(while_node->body));
+        }
+        case NodeKind::PARALLEL: {
+            const auto* parallel_node = static_cast<const ParallelNode*>(node);
+            return arena.make<ParallelNode>(parallel_node->index, clone(parallel_node->begin), clone(parallel_node->end),
+                                            parallel_node->reductions, parallel_node->reduction_count,
+                                            clone_list(parallel_node->body));
+        }
+        case NodeKind::FUNC_CALL: return arena.make<FuncCallNode>(static_cast<const FuncCallNode*>(node)->name);
+        case NodeKind::RETURN: return arena.make<ReturnNode>(clone(static_cast<const ReturnNode*>(node)->expr));
+        case NodeKind::FUNC_DEF:
+            break;
+        }
+        throw std::logic_error("Function definitions are never inlined");
+    }
+
+    NodeList clone_list(const NodeList& body) {
+        std::vector<ASTNode*> statements;
+        for (const ASTNode* stmt : body) statements.push_back(clone(stmt));
+        return NodeList{arena.copy_array(statements), statements.size()};
+    }
+
+    NodeList inline_calls(const NodeList& body) {
+        std::vector<ASTNode*> statements;
+        bool changed = false;
+        for (ASTNode* stmt : body) {
+            if (auto* if_node = node_cast<IfNode>(stmt)) if_node->body = inline_calls(if_node->body);
+            if (auto* while_node = node_cast<WhileNode>(stmt)) while_node->body = inline_calls(while_node->body);
+            const auto* call_node = node_cast<FuncCallNode>(stmt);
+            if (!call_node || !inlinable.count(call_node->name)) {
+                statements.push_back(stmt);
+                continue;
+            }
+            changed = true;
+            for (const ASTNode* inner : defs.at(call_node->name)->body) {
+                if (inner->kind != NodeKind::RETURN) statements.push_back(clone(inner));
+            }
+        }
+        if (!changed) return body;
+        return NodeList{arena.copy_array(statements), statements.size()};
+    }
+
+    void remove_uncalled(NodeList& ast) {
+        bool removed = true;
+        while (removed) {
+            std::set<std::string_view> called;
+            for (const ASTNode* node : ast) collect_calls(node, called);
+            std::vector<ASTNode*> statements;
+            for (ASTNode* node : ast) {
+                const auto* func_def_node = node_cast<FuncDefNode>(node);
+                if (!func_def_node || called.count(func_def_node->name)) statements.push_back(node);
+            }
+            removed = statements.size() != ast.size();
+            if (removed) ast = NodeList{arena.copy_array(statements), statements.size()};
+        }
+    }
+};
+
+void optimize(NodeList& ast, Arena& arena, int level, bool inline_functions = true) {
+    if (level >= OPT_BASIC) {
+        if (inline_functions) Inliner(arena).run(ast);
+        Optimizer(arena).run(ast);
+    }
+}
+
+
+// --- Loop Analysis ---
+// Finds the counted '몰' loops of a typed tree at -O1 and records them in ctx.counted_loops.
+// Inside such a loop the induction variable is known to be an int, so its reads in the body
+// are retyped to native ints. Int arithmetic on values the loop never changes is computed
+// once before the loop, and products of the induction variable with a literal or an
+// unchanging variable become sums stepped with it. Only native int expressions are moved,
+// since they cannot throw. Loops in functions a '몰몰' body may call are left alone, because
+// their assignments are checked writes.
+class LoopAnalysis {
+public:
+    explicit LoopAnalysis(CompilationContext& ctx) : ctx(ctx) {}
+
+    void run(const NodeList& ast) {
+        std::set<std::string_view> checked = parallel_callees(ast);
+        for (const ASTNode* node : ast) {
+            if (const auto* func_def_node = node_cast<FuncDefNode>(node)) {
+                std::map<std::string_view, const ASTNode*> values;
+                for (const ASTNode* stmt : func_def_node->body) {
+                    collect_calls(stmt, graph[func_def_node->name]);
+                    count_assignments(stmt, assignments[func_def_node->name], values);
+                }
+            }
+        }
+        for (ASTNode* node : ast) {
+            const auto* func_def_node = node_cast<FuncDefNode>(node);
+            if (!func_def_node || !checked.count(func_def_node->name)) find_loops(node);
+        }
+    }
+
+private:
+    CompilationContext& ctx;
+    CallGraph graph;
+    std::map<std::string_view, std::map<std::string_view, int>> assignments; // per function
+    std::set<const ASTNode*> claimed; // moved out of an enclosing loop already
+
+    // Outer loops first, so the reads they retype are seen by the loops nested in them.
+    void find_loops(ASTNode* node) {
+        if (auto* while_node = node_cast<WhileNode>(node)) analyze(while_node);
+        for_each_child(node, [&](ASTNode* child) { find_loops(child); });
+    }
+
+    // The variables assigned by the functions `calls` can reach.
+    std::set<std::string_view> assigned_by_calls(const std::set<std::string_view>& calls) const {
+        std::set<std::string_view> reached(calls.begin(), calls.end());
+        std::vector<std::string_view> pending(calls.begin(), calls.end());
+        while (!pending.empty()) {
+            auto it = graph.find(pending.back());
+            pending.pop_back();
+            if (it == graph.end()) continue;
+            for (std::string_view callee : it->second) {
+                if (reached.insert(callee).second) pending.push_back(callee);
+            }
+        }
+        std::set<std::string_view> vars;
+        for (std::string_view function : reached) {
+            auto it = assignments.find(function);
+            if (it == assignments.end()) continue;
+            for (const auto& pair : it->second) vars.insert(pair.first);
+        }
+        return vars;
+    }
+
+    // `var 은 var 합 <literal>` or `var 은 <literal> 합 var`.
+    static bool step_of(const AssignNode* assign_node, int& step) {
+        const auto* binary_op_node = node_cast<BinaryOpNode>(assign_node->expr);
+        if (!binary_op_node || binary_op_node->op != "+") return false;
+        auto is_var = [&](const ASTNode* operand) {
+            const auto* variable_node = node_cast<VariableNode>(operand);
+            return variable_node && variable_node->name == assign_node->var_name;
+        };
+        const auto* number_node = node_cast<NumberNode>(binary_op_node->right);
+        if (!(is_var(binary_op_node->left) && number_node)) {
+            number_node = node_cast<NumberNode>(binary_op_node->left);
+            if (!(is_var(binary_op_node->right) && number_node)) return false;
+        }
+        step = number_node->value;
+        return true;
+    }
+
+    void analyze(WhileNode* loop) {
+        const auto* cond = node_cast<BinaryOpNode>(loop->condition);
+        if (!cond || (cond->op != "<" && cond->op != "<=") || loop->body.size() == 0 || defines_function(loop)) return;
+        const auto* last = node_cast<AssignNode>(loop->body.items[loop->body.size() - 1]);
+        CountedLoop counted;
+        if (!last || !step_of(last, counted.step)) return;
+        counted.var = last->var_name;
+        const auto* left = node_cast<VariableNode>(cond->left);
+        const auto* right = node_cast<VariableNode>(cond->right);
+        if (left && left->name == counted.var) {
+            counted.bound = cond->right;
+            counted.bound_first = false;
+        } else if (right && right->name == counted.var) {
+            counted.bound = cond->left;
+            counted.bound_first = true;
+        } else {
+            return;
+        }
+        // A step away from the bound only ends by overflowing; such loops stay while loops.
+        if (counted.bound_first ? counted.step >= 0 : counted.step <= 0) return;
+        if (!(ctx.variable_type(counted.var) & TYPE_INT)) return;
+        const auto* bound_var = node_cast<VariableNode>(counted.bound);
+        if (!bound_var && counted.bound->kind != NodeKind::NUMBER) return;
+        if (bound_var && bound_var->name == counted.var) return;
+
+        std::map<std::string_view, int> counts;
+        std::map<std::string_view, const ASTNode*> values;
+        std::set<std::string_view> calls;
+        bool returns = false;
+        for (const ASTNode* stmt : loop->body) {
+            count_assignments(stmt, counts, values);
+            collect_calls(stmt, calls);
+            returns = returns || contains_return(stmt);
+        }
+        std::set<std::string_view> written = assigned_by_calls(calls);
+        if (counts[counted.var] != 1 || written.count(counted.var)) return;
+        for (const auto& pair : counts) written.insert(pair.first);
+        if (bound_var && written.count(bound_var->name)) return;
+        counted.guarded = !cond->native;
+        counted.sync = !calls.empty() || returns;
+
+        for (size_t i = 0; i + 1 < loop->body.size(); ++i) retype_reads(loop->body.items[i], counted);
+        for (size_t i = 0; i + 1 < loop->body.size(); ++i) find_moved(loop->body.items[i], counted, written);
+        ctx.counted_loops.emplace(loop, std::move(counted));
+    }
+
+    // Once the condition has been tested, the variable and the bound are ints for the whole loop.
+    void retype_reads(ASTNode* node, CountedLoop& counted) {
+        for_each_child(node, [&](ASTNode* child) { retype_reads(child, counted); });
+        if (const auto* variable_node = node_cast<VariableNode>(node)) {
+            const auto* bound_var = node_cast<VariableNode>(counted.bound);
+            if (variable_node->name == counted.var) {
+                counted.reads.push_back(node);
+            } else if (bound_var && variable_node->name == bound_var->name) {
+                counted.bound_reads.push_back(node);
+            } else {
+                return;
+            }
+            node->type = TYPE_INT;
+            node->native = true;
+        } else if (auto* binary_op_node = node_cast<BinaryOpNode>(node)) {
+            annotate_binary_op(binary_op_node);
+        }
+    }
+
+    // True if `node` is native int arithmetic on literals and variables the loop never assigns.
+    static bool is_invariant(const ASTNode* node, const CountedLoop& counted, const std::set<std::string_view>& written,
+                             bool& reads_variable) {
+        if (!node->native || node->type != TYPE_INT) return false;
+        switch (node->kind) {
+        case NodeKind::NUMBER:
+            return true;
+        case NodeKind::VARIABLE: {
+            std::string_view name = static_cast<const VariableNode*>(node)->name;
+            reads_variable = true;
+            return name != counted.var && !written.count(name);
+        }
+        case NodeKind::BINARY_OP: {
+            const auto* binary_op_node = static_cast<const BinaryOpNode*>(node);
+            return is_invariant(binary_op_node->left, counted, written, reads_variable) &&
+                   is_invariant(binary_op_node->right, counted, written, reads_variable);
+        }
+        default:
+            return false;
+        }
+    }
+
+    void find_moved(const ASTNode* node, CountedLoop& counted, const std::set<std::string_view>& written) {
+        if (claimed.count(node)) return;
+        const auto* binary_op_node = node_cast<BinaryOpNode>(node);
+        if (binary_op_node && binary_op_node->native && binary_op_node->type == TYPE_INT) {
+            // Literal-only arithmetic has been folded already.
+            bool reads_variable = false;
+            if (is_invariant(node, counted, written, reads_variable) && reads_variable) {
+                counted.invariants.push_back(node);
+                claimed.insert(node);
+                return;
+            }
+            if (binary_op_node->op == "*" && scale(binary_op_node, counted, written)) {
+                claimed.insert(node);
+                return;
+            }
+        }
+        for_each_child(node, [&](const ASTNode* child) { find_moved(child, counted, written); });
+    }
+
+    bool scale(const BinaryOpNode* product, CountedLoop& counted, const std::set<std::string_view>& written) {
+        auto is_induction = [&](const ASTNode* operand) {
+            return std::find(counted.reads.begin(), counted.reads.end(), operand) != counted.reads.end();
+        };
+        const ASTNode* factor = is_induction(product->left)    ? product->right
+                                : is_induction(product->right) ? product->left
+                                                               : nullptr;
+        bool reads_variable = false;
+        if (!factor || (factor->kind != NodeKind::NUMBER && factor->kind != NodeKind::VARIABLE) ||
+            !is_invariant(factor, counted, written, reads_variable)) {
+            return false;
+        }
+        for (auto& scaled : counted.scaled) {
+            if (same_value(scaled.factor, factor)) {
+                scaled.products.push_back(product);
+                return true;
+            }
+        }
+        counted.scaled.push_back({factor, {product}});
+        return true;
+    }
+
+    static bool same_value(const ASTNode* a, const ASTNode* b) {
+        if (const auto* number_node = node_cast<NumberNode>(a)) {
+            const auto* other = node_cast<NumberNode>(b);
+            return other && other->value == number_node->value;
+        }
+        const auto* variable_node = node_cast<VariableNode>(a);
+        const auto* other = node_cast<VariableNode>(b);
+        return variable_node && other && variable_node->name == other->name;
+    }
+};
+
+
+// --- Code Writer ---
+// Output buffer for generated source. Everything is appended to one reusable buffer that is
+// handed to the sink in large chunks, so generation never copies a subtree's text and memory
+// stays flat no matter how large the program is.
+class CodeWriter {
+public:
+    explicit CodeWriter(std::ostream& sink) : sink(sink) { buffer.reserve(FLUSH_THRESHOLD + 4096); }
+    ~CodeWriter() { flush(); }
+
+    CodeWriter(const CodeWriter&) = delete;
+    CodeWriter& operator=(const CodeWriter&) = delete;
+
+    CodeWriter& operator<<(std::string_view text) {
+        buffer.append(text);
+        return *this;
+    }
+
+    CodeWriter& operator<<(char c) {
+        buffer.push_back(c);
+        return *this;
+    }
+
+    CodeWriter& operator<<(int value) {
+        char digits[16];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        buffer.append(digits, result.ptr);
+        return *this;
+    }
+
+    void indent() { ++depth; }
+    void dedent() { --depth; }
+
+    // Writes the indentation of the current nesting depth.
+    void begin_line() { buffer.append(depth * INDENT_WIDTH, ' '); }
+
+    void end_line() {
+        buffer.push_back('\n');
+        if (buffer.size() >= FLUSH_THRESHOLD) flush();
+    }
+
+    void flush() {
+        sink.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        flushed += buffer.size();
+        buffer.clear();
+    }
+
+    size_t bytes_written() const { return flushed + buffer.size(); }
+
+private:
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+    static constexpr size_t INDENT_WIDTH = 4;
+
+    std::ostream& sink;
+    std::string buffer;
+    size_t depth = 0;
+    size_t flushed = 0;
+};
+
+
+// --- Code Generator ---
+void collect_symbols(CompilationContext& ctx, const ASTNode* node) {
+    switch (node->kind) {
+    case NodeKind::ASSIGN: ctx.get_cpp_var(static_cast<const AssignNode*>(node)->var_name); break;
+    case NodeKind::VARIABLE: ctx.get_cpp_var(static_cast<const VariableNode*>(node)->name); break;
+    case NodeKind::FUNC_DEF: ctx.get_cpp_func(static_cast<const FuncDefNode*>(node)->name); break;
+    case NodeKind::FUNC_CALL: ctx.get_cpp_func(static_cast<const FuncCallNode*>(node)->name); break;
+    case NodeKind::PARALLEL: {
+        const auto* parallel_node = static_cast<const ParallelNode*>(node);
+        ctx.get_cpp_var(parallel_node->index);
+        for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+            ctx.get_cpp_var(r->var_name);
+        }
+        break;
+    }
+    default: break;
+    }
+    for_each_child(node, [&](const ASTNode* child) { collect_symbols(ctx, child); });
+}
+
+// Every distinct string literal is emitted once as a file-scope constant named str_N, so
+// using a literal never allocates.
+struct StringLiterals {
+    std::map<std::string_view, int> ids;
+    std::vector<std::string_view> values; // in order of first use
+
+    void collect(const ASTNode* node) {
+        if (const auto* string_node = node_cast<StringNode>(node)) {
+            if (ids.emplace(string_node->value, static_cast<int>(values.size())).second) {
+                values.push_back(string_node->value);
+            }
+        }
+        for_each_child(node, [&](const ASTNode* child) { collect(child); });
+    }
+
+    int id(std::string_view value) const { return ids.at(value); }
+};
+
+// INT_MIN has no decimal literal of type int in C++.
+void write_int_literal(CodeWriter& out, int value) {
+    if (value == std::numeric_limits<int>::min()) {
+        out << "(-2147483647 - 1)";
+    } else {
+        out << value;
+    }
+}
+
+// Writes `text` as a C++ string literal whose value is exactly those bytes. Quotes,
+// backslashes and control bytes are escaped, the latter as three-digit octal so a following
+// digit is never taken as part of the escape; UTF-8 passes through unchanged.
+void write_string_literal(CodeWriter& out, std::string_view text) {
+    out << '"';
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (byte < 0x20 || byte == 0x7f) {
+            out << '\\' << static_cast<char>('0' + (byte >> 6)) << static_cast<char>('0' + ((byte >> 3) & 7))
+                << static_cast<char>('0' + (byte & 7));
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// MolObject accessor returning the native value of type `t`.
+std::string_view native_accessor(TypeSet t) {
+    if (t == TYPE_INT) return "as_int";
+    if (t == TYPE_STRING) return "as_string";
+    return "as_bool";
+}
+
+bool reads_variable(const ASTNode* node, std::string_view name) {
+    if (const auto* var_node = node_cast<VariableNode>(node)) return var_node->name == name;
+    bool found = false;
+    for_each_child(node, [&](const ASTNode* child) { found = found || reads_variable(child, name); });
+    return found;
+}
+
+// For an assignment `var = var + a + b ...` where no operand reads var again, the operands
+// a, b, ... in order; empty otherwise. Such assignments extend the variable in place instead
+// of copying it, so building a string in a loop is linear.
+std::vector<const ASTNode*> self_append_operands(const AssignNode* node) {
+    std::vector<const ASTNode*> operands;
+    const ASTNode* expr = node->expr;
+    while (const auto* binary_op_node = node_cast<BinaryOpNode>(expr)) {
+        if (binary_op_node->op != "+" || reads_variable(binary_op_node->right, node->var_name)) break;
+        operands.push_back(binary_op_node->right);
+        expr = binary_op_node->left;
+    }
+    const auto* var_node = node_cast<VariableNode>(expr);
+    if (!var_node || var_node->name != node->var_name) return {};
+    std::reverse(operands.begin(), operands.end());
+    return operands;
+}
+
+// True if evaluating `expr` may read input or throw, which makes its order relative to another
+// such operand observable. Native expressions do neither, and '==' never throws.
+bool has_effects(const ASTNode* expr) {
+    if (expr->native) return false;
+    if (expr->kind == NodeKind::INPUT) return true;
+    const auto* binary_op_node = node_cast<BinaryOpNode>(expr);
+    if (!binary_op_node) return false;
+    return binary_op_node->op != "==" || has_effects(binary_op_node->left) || has_effects(binary_op_node->right);
+}
+
+// True if `var` may be read in `body` before the body assigns it, given whether it is
+// already assigned on entry.
+bool may_read_unassigned(const NodeList& body, std::string_view var, bool assigned) {
+    for (const ASTNode* stmt : body) {
+        if (assigned) return false;
+        switch (stmt->kind) {
+        case NodeKind::ASSIGN: {
+            const auto* assign_node = static_cast<const AssignNode*>(stmt);
+            if (reads_variable(assign_node->expr, var)) return true;
+            assigned = assign_node->var_name == var;
+            break;
+        }
+        case NodeKind::PRINT:
+            if (reads_variable(static_cast<const PrintNode*>(stmt)->expr, var)) return true;
+            break;
+        case NodeKind::RETURN:
+            if (reads_variable(static_cast<const ReturnNode*>(stmt)->expr, var)) return true;
+            break;
+        case NodeKind::IF: {
+            const auto* if_node = static_cast<const IfNode*>(stmt);
+            if (reads_variable(if_node->condition, var) || may_read_unassigned(if_node->body, var, false)) return true;
+            break;
+        }
+        case NodeKind::WHILE: {
+            // Later iterations start with at least what the first one assigned.
+            const auto* while_node = static_cast<const WhileNode*>(stmt);
+            if (reads_variable(while_node->condition, var) || may_read_unassigned(while_node->body, var, false)) return true;
+            break;
+        }
+        case NodeKind::PARALLEL: {
+            // A reduction is read before the loop; the body's own variables start unassigned in
+            // every iteration, so the body never sees a value from outside for those.
+            const auto* parallel_node = static_cast<const ParallelNode*>(stmt);
+            if (reads_variable(parallel_node->begin, var) || reads_variable(parallel_node->end, var)) return true;
+            for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+                if (r->var_name == var) return true;
+            }
+            if (var != parallel_node->index && !iteration_private_vars(parallel_node).count(var) &&
+                may_read_unassigned(parallel_node->body, var, false)) {
+                return true;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return false;
+}
+
+const char* cpp_type(TypeSet t) {
+    if (t == TYPE_INT) return "int";
+    if (t == TYPE_BOOL) return "bool";
+    if (t == TYPE_STRING) return "std::string";
+    return "MolObject";
+}
+
+// Functions that never return a value are void; the result of a call is always discarded.
+const char* cpp_return_type(TypeSet t) { return t == 0 ? "void" : cpp_type(t); }
+
+// Declares a variable with the C++ type its inferred type maps to, without the line break.
+void write_declaration(CodeWriter& out, CompilationContext& ctx, std::string_view mol_var) {
+    TypeSet t = ctx.variable_type(mol_var);
+    out << cpp_type(t) << ' ' << ctx.get_cpp_var(mol_var);
+    if (t == TYPE_INT) {
+        out << " = 0";
+    } else if (t == TYPE_BOOL) {
+        out << " = false";
+    }
+    out << ';';
+}
+
+// Finds the variables that can be C++ locals instead of globals. A variable used only by the
+// top-level statements becomes a local of main(). One used only inside a single function
+// becomes a local of that function if the function is not recursive and always assigns the
+// variable before reading it, so no value is carried from one call to the next. The C++
+// compiler can then keep these in registers instead of reloading globals around every call.
+struct ScopeAnalysis {
+    std::map<std::string_view, std::string_view> owner; // first function using each variable
+    std::set<std::string_view> shared;                   // variables used by several functions
+    CallGraph calls;
+    std::map<std::string_view, const FuncDefNode*> defs;
+    std::map<std::string_view, std::vector<std::string_view>> locals; // by owner, in variable_map order
+    std::set<std::string_view> local_vars;
+    bool nested_function = false;
+
+    void record_use(std::string_view var, std::string_view function) {
+        if (owner.emplace(var, function).first->second != function) shared.insert(var);
+    }
+
+    void record_uses(const ASTNode* node, std::string_view function) {
+        std::string_view var;
+        if (const auto* var_node = node_cast<VariableNode>(node)) var = var_node->name;
+        if (const auto* assign_node = node_cast<AssignNode>(node)) var = assign_node->var_name;
+        if (const auto* call_node = node_cast<FuncCallNode>(node)) calls[function].insert(call_node->name);
+        if (node->kind == NodeKind::FUNC_DEF) nested_function = true;
+        if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+            record_use(parallel_node->index, function);
+            for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+                record_use(r->var_name, function);
+            }
+        }
+        if (!var.empty()) record_use(var, function);
+        for_each_child(node, [&](const ASTNode* child) { record_uses(child, function); });
+    }
+
+    void run(const NodeList& ast) {
+        bool redefined = false;
+        for (const ASTNode* node : ast) {
+            if (const auto* func_def_node = node_cast<FuncDefNode>(node)) {
+                redefined = !defs.emplace(func_def_node->name, func_def_node).second || redefined;
+                for (const ASTNode* stmt : func_def_node->body) record_uses(stmt, func_def_node->name);
+            } else {
+                record_uses(node, MAIN_FUNCTION);
+            }
+        }
+        // Nested or repeated definitions make ownership ambiguous; keep everything global.
+        if (nested_function || redefined) return;
+        for (const auto& pair : owner) {
+            if (shared.count(pair.first)) continue;
+            if (pair.second != MAIN_FUNCTION &&
+                (calls_itself(calls, pair.second) || may_read_unassigned(defs.at(pair.second)->body, pair.first, false))) {
+                continue;
+            }
+            locals[pair.second].push_back(pair.first);
+            local_vars.insert(pair.first);
+        }
+    }
+
+    bool is_local(std::string_view var) const { return local_vars.count(var) != 0; }
+
+    const std::vector<std::string_view>& locals_of(std::string_view function) const {
+        static const std::vector<std::string_view> none;
+        auto it = locals.find(function);
+        return it == locals.end() ? none : it->second;
+    }
+};
+
+// Visitor writing the C++ text of one node into a CodeWriter: expressions become C++
+// expressions and statements become complete, indented C++ lines.
+struct CppGenerator {
+    CppGenerator(CodeWriter& out, CompilationContext& ctx, const StringLiterals& string_literals,
+                 const ScopeAnalysis& scopes)
+        : out(out), ctx(ctx), string_literals(string_literals), scopes(scopes) {}
+
+    CodeWriter& out;
+    CompilationContext& ctx;
+    const StringLiterals& string_literals;
+    const ScopeAnalysis& scopes;
+    TypeSet return_type = TYPE_NONE; // of the function being generated
+    // With --profile, the '몰', '몰몰', '입' and '캠프' nodes given a counter site, in site order.
+    std::vector<const ASTNode*>* profile_sites = nullptr;
+    // Functions reachable from a '몰몰' body, whose assignments check that they do not run on
+    // a worker thread; set while generating one of them, outside its own '몰몰' bodies.
+    const std::set<std::string_view>* parallel_functions = nullptr;
+    bool check_shared_writes = false;
+    // In the body of a counted '몰' loop, the nodes generated as one of its int locals instead.
+    std::map<const ASTNode*, std::string> replaced;
+    int loop_depth = 0; // counted loops around the code, which number their locals
+
+    void generate(const ASTNode* node) const {
+        if (!replaced.empty()) {
+            auto it = replaced.find(node);
+            if (it != replaced.end()) {
+                out << it->second;
+                return;
+            }
+        }
+        visit(node, *this);
+    }
+
+    // Allocates the profile site of `node` and returns the C++ expression naming it.
+    std::string profile_site(const ASTNode* node) const {
+        profile_sites->push_back(node);
+        return "mollang_profile_sites[" + std::to_string(profile_sites->size() - 1) + "]";
+    }
+
+    // Opens a block that times everything up to the matching end_profiled().
+    std::string begin_profiled(const ASTNode* node) const {
+        std::string site = profile_site(node);
+        out << '{';
+        out.end_line();
+        out.indent();
+        out.begin_line();
+        out << "MolProfileScope profile_scope(" << site << ");";
+        out.end_line();
+        out.begin_line();
+        return site;
+    }
+
+    void end_profiled() const {
+        out.end_line();
+        out.dedent();
+        out.begin_line();
+        out << '}';
+    }
+
+    void count_iteration(const std::string& site) const {
+        out.indent();
+        out.begin_line();
+        out << "++" << site << ".iterations;";
+        out.end_line();
+        out.dedent();
+    }
+
+    // Emits an expression as a MolObject, boxing it if it was generated natively.
+    void generate_boxed(const ASTNode* expr) const {
+        if (const auto* string_node = node_cast<StringNode>(expr)) {
+            out << "str_" << string_literals.id(string_node->value); // already a MolObject
+        } else if (expr->native) {
+            out << "MolObject(";
+            generate(expr);
+            out << ')';
+        } else {
+            generate(expr);
+        }
+    }
+
+    // Emits an expression as a native value of type `t`, unboxing it if needed.
+    void generate_native(const ASTNode* expr, TypeSet t) const {
+        if (expr->native) {
+            generate(expr);
+        } else {
+            generate(expr);
+            out << '.' << native_accessor(t) << "()";
+        }
+    }
+
+    // Conditions are emitted as a plain C++ bool: a native comparison when both operand types
+    // are known, otherwise a runtime comparison helper that skips the MolObject(bool).
+    void generate_condition(const ASTNode* cond) const {
+        if (cond->native && cond->type == TYPE_BOOL) {
+            generate(cond);
+            return;
+        }
+        const auto* binary_op_node = node_cast<BinaryOpNode>(cond);
+        if (!binary_op_node || binary_op_node->op == "+" || binary_op_node->op == "*" ||
+            (has_effects(binary_op_node->left) && has_effects(binary_op_node->right))) {
+            out << "mollang_truthy(";
+            generate_boxed(cond);
+            out << ')';
+            return;
+        }
+        std::string_view op = binary_op_node->op;
+        out << (op == "<" ? "mollang_less(" : op == "<=" ? "mollang_less_equal(" : "mollang_equal(");
+        // The helpers take unboxed ints, and unboxed strings for '=='. Two unboxed operands
+        // reaching this point have different types, which no overload takes, so the right
+        // one is boxed.
+        auto unboxed = [&](const ASTNode* operand) {
+            return operand->native && (operand->type == TYPE_INT || (operand->type == TYPE_STRING && op == "=="));
+        };
+        bool left_unboxed = unboxed(binary_op_node->left);
+        if (left_unboxed) {
+            generate(binary_op_node->left);
+        } else {
+            generate_boxed(binary_op_node->left);
+        }
+        out << ", ";
+        if (!left_unboxed && unboxed(binary_op_node->right)) {
+            generate(binary_op_node->right);
+        } else {
+            generate_boxed(binary_op_node->right);
+        }
+        out << ')';
+    }
+
+    void generate_statement(const ASTNode* stmt) const {
+        out.begin_line();
+        generate(stmt);
+        out.end_line();
+    }
+
+    void declare_locals(std::string_view function) const {
+        for (std::string_view var : scopes.locals_of(function)) {
+            out.begin_line();
+            write_declaration(out, ctx, var);
+            out.end_line();
+        }
+    }
+
+    void generate_block(const NodeList& body) const {
+        out.indent();
+        for (const ASTNode* stmt : body) {
+            generate_statement(stmt);
+        }
+        out.dedent();
+    }
+
+    void operator()(const NumberNode* node) const {
+        if (node->native) {
+            write_int_literal(out, node->value);
+        } else {
+            out << "MolObject(";
+            write_int_literal(out, node->value);
+            out << ')';
+        }
+    }
+
+    void operator()(const StringNode* node) const {
+        if (node->native) {
+            out << "str_" << string_literals.id(node->value) << ".as_string()";
+        } else {
+            out << "str_" << string_literals.id(node->value);
+        }
+    }
+
+    void operator()(const BoolNode* node) const {
+        if (!node->native) out << "MolObject(";
+        out << (node->value ? "true" : "false");
+        if (!node->native) out << ')';
+    }
+
+    void operator()(const VariableNode* node) const { out << ctx.get_cpp_var(node->name); }
+
+    void operator()(const InputNode*) const { out << "mollang_input()"; }
+
+    void operator()(const BinaryOpNode* node) const {
+        if (node->native && node->left->type == TYPE_STRING && node->op != "==") {
+            // Native strings may be std::string_views of literals, so use the runtime helpers.
+            out << (node->op == "+" ? "mollang_concat(" : "mollang_repeat(");
+            generate(node->left);
+            out << ", ";
+            generate(node->right);
+            out << ')';
+        } else if (node->native) {
+            out << '(';
+            generate(node->left);
+            out << ' ' << node->op << ' ';
+            generate(node->right);
+            out << ')';
+        } else if (has_effects(node->left) && has_effects(node->right)) {
+            // Operands are evaluated left to right, like the VM and interpreter.py do; the
+            // arguments of an operator call are not sequenced.
+            std::string_view op = node->op;
+            out << "MolOperands{";
+            generate_boxed(node->left);
+            out << ", ";
+            generate_boxed(node->right);
+            out << (op == "+"    ? "}.add()"
+                    : op == "*"  ? "}.multiply()"
+                    : op == "<"  ? "}.less()"
+                    : op == "<=" ? "}.less_equal()"
+                                 : "}.equal()");
+        } else {
+            out << '(';
+            generate_boxed(node->left);
+            out << ' ' << node->op << ' ';
+            generate_boxed(node->right);
+            out << ')';
+        }
+    }
+
+    void operator()(const AssignNode* node) const {
+        if (check_shared_writes) out << "mollang_check_shared_write(); ";
+        std::vector<const ASTNode*> appended = self_append_operands(node);
+        TypeSet t = ctx.variable_type(node->var_name);
+        if (!appended.empty() && t == TYPE_STRING && node->expr->native) {
+            out << ctx.get_cpp_var(node->var_name);
+            for (const ASTNode* operand : appended) {
+                out << ".append(";
+                generate(operand);
+                out << ')';
+            }
+            out << ';';
+            return;
+        }
+        // Nested mollang_append() calls do not sequence a later operand after the earlier appends.
+        bool ordered = std::none_of(appended.begin() + (appended.empty() ? 0 : 1), appended.end(), has_effects);
+        if (!appended.empty() && !is_single_type(t) && ordered) {
+            for (size_t i = 0; i < appended.size(); ++i) out << "mollang_append(";
+            out << ctx.get_cpp_var(node->var_name);
+            for (const ASTNode* operand : appended) {
+                out << ", ";
+                generate_boxed(operand);
+                out << ')';
+            }
+            out << ';';
+            return;
+        }
+        out << ctx.get_cpp_var(node->var_name) << " = ";
+        if (is_single_type(t)) {
+            generate_native(node->expr, t);
+        } else {
+            generate_boxed(node->expr);
+        }
+        out << ';';
+    }
+
+    void operator()(const PrintNode* node) const {
+        out << "mollang_print(";
+        generate(node->expr);
+        out << ");";
+    }
+
+    // A profiled '입' counts how often it is tested and taken; a profiled '몰' how often it
+    // starts and iterates. Both time the condition and body together.
+    void operator()(const IfNode* node) const {
+        std::string site = profile_sites ? begin_profiled(node) : std::string();
+        out << "if (";
+        generate_condition(node->condition);
+        out << ") {";
+        out.end_line();
+        if (profile_sites) count_iteration(site);
+        generate_block(node->body);
+        out.begin_line();
+        out << '}';
+        if (profile_sites) end_profiled();
+    }
+
+    void operator()(const WhileNode* node) const {
+        std::string site = profile_sites ? begin_profiled(node) : std::string();
+        auto counted = ctx.counted_loops.find(node);
+        if (counted != ctx.counted_loops.end()) {
+            generate_counted(node, counted->second, site);
+        } else {
+            out << "while (";
+            generate_condition(node->condition);
+            out << ") {";
+            out.end_line();
+            if (profile_sites) count_iteration(site);
+            generate_block(node->body);
+            out.begin_line();
+            out << '}';
+        }
+        if (profile_sites) end_profiled();
+    }
+
+    // A counted loop steps an int local, loop_index_<depth>, and stores it into the variable
+    // when the loop ends (and before every iteration when the body calls or returns). A
+    // condition that may throw is tested once as written first, which also proves that the
+    // variable and the bound are ints.
+    void generate_counted(const WhileNode* node, const CountedLoop& loop, const std::string& site) const {
+        auto line = [&](auto&&... parts) {
+            out.begin_line();
+            (out << ... << parts);
+            out.end_line();
+        };
+        std::string depth = std::to_string(loop_depth);
+        std::string index = "loop_index_" + depth;
+        const std::string& var = ctx.get_cpp_var(loop.var);
+        if (loop.guarded) {
+            out << "if (";
+            generate_condition(node->condition);
+            out << ") {";
+        } else {
+            out << '{';
+        }
+        out.end_line();
+        out.indent();
+        line("int ", index, " = ", var, ctx.is_native_var(loop.var) ? ";" : ".as_int();");
+        std::string bound;
+        if (const auto* number_node = node_cast<NumberNode>(loop.bound)) {
+            bound = number_node->value == std::numeric_limits<int>::min() ? "(-2147483647 - 1)"
+                                                                          : std::to_string(number_node->value);
+        } else {
+            bound = "loop_bound_" + depth;
+            out.begin_line();
+            out << "const int " << bound << " = ";
+            generate_int(loop.bound);
+            out << ';';
+            out.end_line();
+        }
+
+        CppGenerator body = *this;
+        body.loop_depth++;
+        for (const ASTNode* read : loop.reads) body.replaced[read] = index;
+        for (const ASTNode* read : loop.bound_reads) body.replaced[read] = bound;
+        for (size_t i = 0; i < loop.invariants.size(); ++i) {
+            std::string name = "loop_invariant_" + depth + "_" + std::to_string(i);
+            out.begin_line();
+            out << "const int " << name << " = ";
+            body.generate(loop.invariants[i]);
+            out << ';';
+            out.end_line();
+            body.replaced[loop.invariants[i]] = name;
+        }
+        std::string steps;
+        for (size_t i = 0; i < loop.scaled.size(); ++i) {
+            const CountedLoop::Scaled& scaled = loop.scaled[i];
+            std::string name = "loop_scaled_" + depth + "_" + std::to_string(i);
+            std::string stride;
+            if (const auto* number_node = node_cast<NumberNode>(scaled.factor)) {
+                // Wraps like the int multiplication it replaces.
+                int product = static_cast<int>(static_cast<unsigned>(loop.step) * static_cast<unsigned>(number_node->value));
+                stride = product == std::numeric_limits<int>::min() ? "(-2147483647 - 1)" : std::to_string(product);
+            } else {
+                stride = "loop_stride_" + depth + "_" + std::to_string(i);
+                out.begin_line();
+                out << "const int " << stride << " = " << loop.step << " * ";
+                body.generate(scaled.factor);
+                out << ';';
+                out.end_line();
+            }
+            out.begin_line();
+            out << "int " << name << " = " << index << " * ";
+            body.generate(scaled.factor);
+            out << ';';
+            out.end_line();
+            steps += ", " + name + " += " + stride;
+            for (const ASTNode* product : scaled.products) body.replaced[product] = name;
+        }
+
+        std::string_view op = static_cast<const BinaryOpNode*>(node->condition)->op;
+        out.begin_line();
+        out << "for (; ";
+        if (loop.bound_first) {
+            out << bound << ' ' << op << ' ' << index;
+        } else {
+            out << index << ' ' << op << ' ' << bound;
+        }
+        out << "; " << index << " += " << loop.step << steps << ") {";
+        out.end_line();
+        if (profile_sites) count_iteration(site);
+        out.indent();
+        if (loop.sync) line(var, " = ", index, ';');
+        for (size_t i = 0; i + 1 < node->body.size(); ++i) body.generate_statement(node->body.items[i]);
+        out.dedent();
+        line('}');
+        line(var, " = ", index, ';');
+        out.dedent();
+        out.begin_line();
+        out << '}';
+    }
+
+    // Emits an expression as a native int, throwing like MolObject::as_int() if it is not one.
+    void generate_int(const ASTNode* expr) const {
+        if (expr->native && expr->type == TYPE_INT) {
+            generate(expr);
+        } else {
+            generate_boxed(expr);
+            out << ".as_int()";
+        }
+    }
+
+    // A '몰몰' loop hands a lambda to the runtime's MolParallelLoop, which calls it once per
+    // chunk of the index range. Locals declared in the lambda shadow the globals of the same
+    // name: each reduction starts from its identity once per chunk, and the index and the
+    // body's other variables once per iteration. The chunk results are folded into the
+    // reductions in index order, so the result does not depend on how the range was split.
+    // --profile runs the loop on the calling thread, since its counters are not atomic.
+    void operator()(const ParallelNode* node) const {
+        std::string site = profile_sites ? begin_profiled(node) : std::string();
+        auto line = [&](auto&&... parts) {
+            out.begin_line();
+            (out << ... << parts);
+            out.end_line();
+        };
+        out << '{';
+        out.end_line();
+        out.indent();
+        out.begin_line();
+        out << "MolParallelLoop parallel_loop{"; // braces evaluate the range from left to right
+        generate_int(node->begin);
+        out << ", ";
+        generate_int(node->end);
+        out << (profile_sites ? ", true};" : "};");
+        out.end_line();
+        for (size_t i = 0; i < node->reduction_count; ++i) {
+            const Reduction& r = node->reductions[i];
+            std::string n = std::to_string(i);
+            line("auto reduction_", n, " = mollang_reduction_identity(", ctx.get_cpp_var(r.var_name), ", '", r.op, "');");
+            line("std::vector<decltype(reduction_", n, ")> partials_", n, "(parallel_loop.chunks(), reduction_", n, ");");
+        }
+        line("parallel_loop.run([&](size_t parallel_chunk, int parallel_first, int parallel_last) {");
+        out.indent();
+        for (size_t i = 0; i < node->reduction_count; ++i) {
+            line("auto ", ctx.get_cpp_var(node->reductions[i].var_name), " = reduction_", std::to_string(i), ';');
+        }
+        line("for (int parallel_index = parallel_first; parallel_index < parallel_last; ++parallel_index) {");
+        if (profile_sites) count_iteration(site);
+        out.indent();
+        line(cpp_type(ctx.variable_type(node->index)), ' ', ctx.get_cpp_var(node->index), " = parallel_index;");
+        for (std::string_view var : iteration_private_vars(node)) {
+            out.begin_line();
+            write_declaration(out, ctx, var);
+            out.end_line();
+        }
+        out.dedent();
+        CppGenerator body = *this;
+        body.check_shared_writes = false;
+        body.generate_block(node->body);
+        line('}');
+        for (size_t i = 0; i < node->reduction_count; ++i) {
+            std::string n = std::to_string(i);
+            line("partials_", n, "[parallel_chunk] = std::move(", ctx.get_cpp_var(node->reductions[i].var_name), ");");
+        }
+        out.dedent();
+        line("});");
+        if (check_shared_writes && node->reduction_count > 0) line("mollang_check_shared_write();");
+        for (size_t i = 0; i < node->reduction_count; ++i) {
+            const Reduction& r = node->reductions[i];
+            line("for (auto& partial : partials_", std::to_string(i), ") mollang_reduce(", ctx.get_cpp_var(r.var_name),
+                 ", partial, '", r.op, "');");
+        }
+        out.dedent();
+        out.begin_line();
+        out << '}';
+        if (profile_sites) end_profiled();
+    }
+
+    void operator()(const FuncDefNode* node) const {
+        CppGenerator body = *this;
+        body.return_type = ctx.function_return_type(node->name);
+        body.check_shared_writes = parallel_functions && parallel_functions->count(node->name);
+        out << cpp_return_type(body.return_type) << ' ' << ctx.get_cpp_func(node->name) << "() {";
+        out.end_line();
+        out.indent();
+        declare_locals(node->name);
+        if (profile_sites) {
+            out.begin_line();
+            out << "MolProfileScope profile_scope(" << profile_site(node) << ");";
+            out.end_line();
+        }
+        out.dedent();
+        body.generate_block(node->body);
+        if (body.return_type & TYPE_NONE) {
+            out.indent();
+            out.begin_line();
+            out << "return MolObject();"; // Default return
+            out.end_line();
+            out.dedent();
+        }
+        out.begin_line();
+        out << '}';
+    }
+
+    void operator()(const FuncCallNode* node) const {
+        out << ctx.get_cpp_func(node->name) << "();";
+    }
+
+    void operator()(const ReturnNode* node) const {
+        out << "return ";
+        if (return_type == TYPE_STRING) {
+            out << "std::string(";
+            generate_native(node->expr, return_type);
+            out << ')';
+        } else if (is_single_type(return_type)) {
+            generate_native(node->expr, return_type);
+        } else {
+            generate_boxed(node->expr);
+        }
+        out << ';';
+    }
+};
+
+// String literals are MolObjects built once, so using one never allocates.
+void write_string_literals(CodeWriter& out, const StringLiterals& string_literals) {
+    for (size_t i = 0; i < string_literals.values.size(); ++i) {
+        std::string_view value = string_literals.values[i];
+        out << "static const MolObject str_" << static_cast<int>(i) << '(';
+        if (value.find('\0') == std::string_view::npos) {
+            write_string_literal(out, value);
+        } else {
+            // A NUL byte would end a const char* literal early.
+            out << "std::string_view(";
+            write_string_literal(out, value);
+            out << ", " << static_cast<int>(value.size()) << ')';
+        }
+        out << ");\n";
+    }
+    if (!string_literals.values.empty()) out << '\n';
+}
+
+// main(): output setup, the locals of the top-level statements, then the statements.
+void write_main(CodeWriter& out, const CppGenerator& generator, const NodeList& ast, const CompileOptions& options) {
+    out << "int main() {";
+    out.end_line();
+    out.indent();
+    out.begin_line();
+    out << "mollang_init_output(" << (options.line_buffered ? "true" : "false") << ");";
+    out.end_line();
+    if (options.profile) {
+        out.begin_line();
+        out << "mollang_profile_init(mollang_profile_sites, mollang_profile_site_count);";
+        out.end_line();
+    }
+    generator.declare_locals(MAIN_FUNCTION);
+    for (const ASTNode* node : ast) {
+        if (node->kind != NodeKind::FUNC_DEF) {
+            generator.generate_statement(node);
+        }
+    }
+    out.begin_line();
+    out << "return 0;";
+    out.end_line();
+    out.dedent();
+    out << "}\n";
+}
+
+void generate_cpp_code(CompilationContext& ctx, const NodeList& ast, const CompileOptions& options, std::ostream& sink) {
+    CodeWriter out(sink);
+
+    // Preamble: the runtime is prebuilt into a static library and precompiled header.
+    out << "#include \"mollang_runtime.hpp\"\n\n";
+
+    // Function Prototypes
+    for (const auto& pair : ctx.function_map) {
+        out << cpp_return_type(ctx.function_return_type(pair.first)) << ' ' << pair.second << "();\n";
+    }
+    out << '\n';
+
+    // Profile sites are only known once everything is generated, so the table comes last.
+    std::vector<const ASTNode*> profile_sites;
+    if (options.profile) {
+        out << "extern MolProfileSite mollang_profile_sites[];\n";
+        out << "extern const size_t mollang_profile_site_count;\n\n";
+    }
+
+    // String Literals
+    StringLiterals string_literals;
+    for (const ASTNode* node : ast) {
+        string_literals.collect(node);
+    }
+    write_string_literals(out, string_literals);
+
+    ScopeAnalysis scopes;
+    scopes.run(ast);
+
+    // Global Variables
+    for (const auto& pair : ctx.variable_map) {
+        if (scopes.is_local(pair.first)) continue;
+        write_declaration(out, ctx, pair.first);
+        out << '\n';
+    }
+    out << '\n';
+
+    std::set<std::string_view> parallel_functions = parallel_callees(ast);
+    CppGenerator generator(out, ctx, string_literals, scopes);
+    if (options.profile) generator.profile_sites = &profile_sites;
+    generator.parallel_functions = &parallel_functions;
+
+    // Function Definitions
+    for (const ASTNode* node : ast) {
+        if (node->kind == NodeKind::FUNC_DEF) {
+            generator.generate_statement(node);
+            out.end_line();
+        }
+    }
+
+    write_main(out, generator, ast, options);
+
+    if (options.profile) {
+        out << "\nMolProfileSite mollang_profile_sites[] = {\n";
+        for (const ASTNode* node : profile_sites) {
+            const auto* func_def_node = node_cast<FuncDefNode>(node);
+            std::string_view label = func_def_node                       ? func_def_node->name
+                                     : node->kind == NodeKind::WHILE    ? "몰"
+                                     : node->kind == NodeKind::PARALLEL ? "몰몰"
+                                                                        : "입";
+            out << "    {";
+            write_string_literal(out, label);
+            out << ", " << node->line << ", " << static_cast<int>(node->column) << "},\n";
+        }
+        if (profile_sites.empty()) out << "    {\"\", 0, 0},\n"; // an array cannot be empty
+        out << "};\n";
+        out << "const size_t mollang_profile_site_count = " << static_cast<int>(profile_sites.size()) << ";\n";
+    }
+    if (ctx.stats) ctx.stats->emitted_bytes = out.bytes_written();
+}
+
+std::string generate_cpp_code(CompilationContext& ctx, const NodeList& ast, const CompileOptions& options) {
+    std::ostringstream ss;
+    generate_cpp_code(ctx, ast, options, ss);
+    return ss.str();
+}
+
+// One C++ source file of an --incremental build.
+struct TranslationUnit {
+    std::string name; // file name without the .cpp
+    std::string code;
+};
+
+void collect_variables(const ASTNode* node, std::set<std::string_view>& vars) {
+    if (const auto* assign_node = node_cast<AssignNode>(node)) vars.insert(assign_node->var_name);
+    if (const auto* variable_node = node_cast<VariableNode>(node)) vars.insert(variable_node->name);
+    if (const auto* parallel_node = node_cast<ParallelNode>(node)) {
+        vars.insert(parallel_node->index);
+        for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+            vars.insert(r->var_name);
+        }
+    }
+    for_each_child(node, [&](const ASTNode* child) { collect_variables(child, vars); });
+}
+
+// Splits the program for --incremental: one unit per function and one holding the globals
+// and main(). Rather than sharing a header, each unit declares just the functions and
+// globals it uses, with names derived from the Mollang names (CompilationContext::
+// stable_names), so a unit's text only changes when its own code or something it uses
+// changes, and its object file can be reused otherwise.
+std::vector<TranslationUnit> generate_cpp_units(CompilationContext& ctx, const NodeList& ast, const CompileOptions& options) {
+    ScopeAnalysis scopes;
+    scopes.run(ast);
+    std::set<std::string_view> parallel_functions = parallel_callees(ast);
+    std::vector<TranslationUnit> units;
+    size_t emitted = 0;
+    auto emit_unit = [&](std::string name, const std::vector<const ASTNode*>& nodes, bool defines_globals, auto&& body) {
+        std::ostringstream ss;
+        {
+            CodeWriter out(ss);
+            out << "#include \"mollang_runtime.hpp\"\n\n";
+            std::set<std::string_view> calls;
+            std::set<std::string_view> vars;
+            StringLiterals string_literals;
+            for (const ASTNode* node : nodes) {
+                collect_calls(node, calls);
+                collect_variables(node, vars);
+                string_literals.collect(node);
+            }
+            for (std::string_view func : calls) {
+                out << cpp_return_type(ctx.function_return_type(func)) << ' ' << ctx.get_cpp_func(func) << "();\n";
+            }
+            if (!calls.empty()) out << '\n';
+            write_string_literals(out, string_literals);
+            if (defines_globals) {
+                for (const auto& pair : ctx.variable_map) {
+                    if (scopes.is_local(pair.first)) continue;
+                    write_declaration(out, ctx, pair.first);
+                    out << '\n';
+                }
+            } else {
+                for (std::string_view var : vars) {
+                    if (scopes.is_local(var)) continue;
+                    out << "extern " << cpp_type(ctx.variable_type(var)) << ' ' << ctx.get_cpp_var(var) << ";\n";
+                }
+            }
+            out << '\n';
+            CppGenerator generator(out, ctx, string_literals, scopes);
+            generator.parallel_functions = &parallel_functions;
+            body(out, generator);
+            emitted += out.bytes_written();
+        }
+        units.push_back({std::move(name), ss.str()});
+    };
+
+    std::set<std::string_view> defined;
+    std::vector<const ASTNode*> top_level;
+    for (const ASTNode* node : ast) {
+        const auto* func_def_node = node_cast<FuncDefNode>(node);
+        if (!func_def_node) {
+            top_level.push_back(node);
+            continue;
+        }
+        if (!defined.insert(func_def_node->name).second) {
+            throw std::runtime_error("Function '" + std::string(func_def_node->name) + "' is defined more than once.");
+        }
+        emit_unit(ctx.get_cpp_func(func_def_node->name), {node}, false, [&](CodeWriter& out, const CppGenerator& generator) {
+            generator.generate_statement(node);
+            out.end_line();
+        });
+    }
+    emit_unit("main", top_level, true, [&](CodeWriter& out, const CppGenerator& generator) {
+        write_main(out, generator, ast, options);
+    });
+    if (ctx.stats) ctx.stats->emitted_bytes = emitted;
+    return units;
+}
+
+
+// --- Bytecode VM ---
+// The VM evaluates with the same runtime library the compiled programs link against, so
+// `--run` behaves like the compiled executable.
+enum class OpCode : unsigned char {
+    PUSH_CONST, LOAD, STORE, APPEND, ADD, MUL, LESS, LESS_EQUAL, EQUAL,
+    PRINT, INPUT, JUMP, JUMP_IF_FALSE,
+    JUMP_IF_NOT_LESS, JUMP_IF_NOT_LESS_EQUAL, JUMP_IF_NOT_EQUAL, // fused compare-and-branch
+    PARALLEL_BEGIN, PARALLEL_NEXT, CHECK_SHARED,
+    CALL, POP, RETURN, HALT
+};
+
+struct Instruction {
+    OpCode op;
+    int arg; // constant index, global slot or jump target, depending on `op`
+};
+
+// The VM runs a '몰몰' loop's iterations in order on one thread. Inside the body, the index, the
+// body's own variables and the reductions live in slots of their own, like the lambda locals
+// of the compiled loop, so functions called from the body still see the shared globals.
+struct ParallelLoop {
+    int index;                 // slot holding the index
+    std::vector<int> privates; // slots reset every iteration
+    struct Reduction {
+        int target;  // the global folded into after the loop
+        int partial; // where the body accumulates
+        char op;
+    };
+    std::vector<Reduction> reductions;
+};
+
+struct BytecodeProgram {
+    std::vector<Instruction> code; // main body first, then every function body
+    std::vector<MolObject> constants;
+    std::vector<ParallelLoop> parallel_loops;
+    size_t global_count = 0;
+};
+
+// Lowers the AST into a flat stack-based bytecode program.
+class BytecodeCompiler {
+public:
+    BytecodeProgram compile(const NodeList& ast) {
+        for (const auto& node : ast) {
+            if (const auto* func_def_node = node_cast<FuncDefNode>(node)) {
+                if (!functions.emplace(func_def_node->name, func_def_node).second) {
+                    throw std::runtime_error("Function '" + std::string(func_def_node->name) + "' is defined more than once.");
+                }
+            }
+        }
+
+        in_function = false;
+        for (const auto& node : ast) {
+            if (node->kind != NodeKind::FUNC_DEF) {
+                emit_statement(node);
+            }
+        }
+        emit(OpCode::HALT);
+
+        in_function = true;
+        std::set<std::string_view> parallel_functions = parallel_callees(ast);
+        std::map<std::string_view, int> entries;
+        for (const auto& pair : functions) {
+            check_shared_writes = parallel_functions.count(pair.first) != 0;
+            entries[pair.first] = static_cast<int>(program.code.size());
+            for (const auto& stmt : pair.second->body) {
+                emit_statement(stmt);
+            }
+            emit(OpCode::PUSH_CONST, constant(MolObject()));
+            emit(OpCode::RETURN);
+        }
+
+        for (const auto& call : calls) {
+            auto it = entries.find(call.second);
+            if (it == entries.end()) {
+                throw std::runtime_error("Function '" + std::string(call.second) + "' is not defined.");
+            }
+            program.code[call.first].arg = it->second;
+        }
+
+        program.global_count = slot_count;
+        return std::move(program);
+    }
+
+private:
+    BytecodeProgram program;
+    std::map<std::string_view, const FuncDefNode*> functions;
+    std::map<std::string_view, int> globals;
+    std::map<int, int> int_constants;
+    std::map<std::string, int, std::less<>> string_constants;
+    std::vector<std::pair<size_t, std::string_view>> calls; // CALL instruction index -> function name
+    bool in_function = false;
+    bool check_shared_writes = false; // in a function a '몰몰' body may call
+    int slot_count = 0;
+    std::vector<std::map<std::string_view, int>> private_slots; // of the enclosing '몰몰' bodies, innermost last
+
+    size_t emit(OpCode op, int arg = 0) {
+        program.code.push_back({op, arg});
+        return program.code.size() - 1;
+    }
+
+    int constant(const MolObject& value) {
+        auto add = [&]() {
+            program.constants.push_back(value);
+            return static_cast<int>(program.constants.size() - 1);
+        };
+        if (value.is_int()) {
+            int v = value.as_int();
+            auto it = int_constants.find(v);
+            return it != int_constants.end() ? it->second : (int_constants[v] = add());
+        }
+        if (value.is_string()) {
+            std::string_view v = value.as_string();
+            auto it = string_constants.find(v);
+            return it != string_constants.end() ? it->second : (string_constants[std::string(v)] = add());
+        }
+        return add();
+    }
+
+    int global(std::string_view name) {
+        for (auto scope = private_slots.rbegin(); scope != private_slots.rend(); ++scope) {
+            auto it = scope->find(name);
+            if (it != scope->end()) return it->second;
+        }
+        auto it = globals.find(name);
+        if (it != globals.end()) return it->second;
+        return globals[name] = slot_count++;
+    }
+
+    void emit_expression(const ASTNode* node) {
+        switch (node->kind) {
+        case NodeKind::NUMBER:
+            emit(OpCode::PUSH_CONST, constant(MolObject(static_cast<const NumberNode*>(node)->value)));
+            break;
+        case NodeKind::STRING:
+            emit(OpCode::PUSH_CONST, constant(MolObject(std::string(static_cast<const StringNode*>(node)->value))));
+            break;
+        case NodeKind::BOOL:
+            emit(OpCode::PUSH_CONST, constant(MolObject(static_cast<const BoolNode*>(node)->value)));
+            break;
+        case NodeKind::VARIABLE:
+            emit(OpCode::LOAD, global(static_cast<const VariableNode*>(node)->name));
+            break;
+        case NodeKind::INPUT:
+            emit(OpCode::INPUT);
+            break;
+        case NodeKind::BINARY_OP: {
+            const auto* binary_op_node = static_cast<const BinaryOpNode*>(node);
+            emit_expression(binary_op_node->left);
+            emit_expression(binary_op_node->right);
+            std::string_view op = binary_op_node->op;
+            if (op == "+") emit(OpCode::ADD);
+            else if (op == "*") emit(OpCode::MUL);
+            else if (op == "<") emit(OpCode::LESS);
+            else if (op == "<=") emit(OpCode::LESS_EQUAL);
+            else emit(OpCode::EQUAL);
+            break;
+        }
+        default:
+            throw std::runtime_error("Unsupported expression in bytecode compiler.");
+        }
+    }
+
+    // Emits the test of an '입'/'몰' and returns the conditional jump to patch. Comparisons
+    // branch directly on their operands instead of pushing a bool first.
+    size_t emit_condition(const ASTNode* cond) {
+        if (const auto* binary_op_node = node_cast<BinaryOpNode>(cond)) {
+            std::string_view op = binary_op_node->op;
+            if (op == "<" || op == "<=" || op == "==") {
+                emit_expression(binary_op_node->left);
+                emit_expression(binary_op_node->right);
+                if (op == "<") return emit(OpCode::JUMP_IF_NOT_LESS);
+                if (op == "<=") return emit(OpCode::JUMP_IF_NOT_LESS_EQUAL);
+                return emit(OpCode::JUMP_IF_NOT_EQUAL);
+            }
+        }
+        emit_expression(cond);
+        return emit(OpCode::JUMP_IF_FALSE);
+    }
+
+    void emit_block(const NodeList& body) {
+        for (const ASTNode* stmt : body) {
+            emit_statement(stmt);
+        }
+    }
+
+    void emit_statement(const ASTNode* node) {
+        switch (node->kind) {
+        case NodeKind::ASSIGN: {
+            const auto* assign_node = static_cast<const AssignNode*>(node);
+            if (check_shared_writes) emit(OpCode::CHECK_SHARED);
+            std::vector<const ASTNode*> appended = self_append_operands(assign_node);
+            if (!appended.empty()) {
+                for (const ASTNode* operand : appended) {
+                    emit_expression(operand);
+                    emit(OpCode::APPEND, global(assign_node->var_name));
+                }
+                break;
+            }
+            emit_expression(assign_node->expr);
+            emit(OpCode::STORE, global(assign_node->var_name));
+            break;
+        }
+        case NodeKind::PRINT:
+            emit_expression(static_cast<const PrintNode*>(node)->expr);
+            emit(OpCode::PRINT);
+            break;
+        case NodeKind::IF: {
+            const auto* if_node = static_cast<const IfNode*>(node);
+            size_t jump = emit_condition(if_node->condition);
+            emit_block(if_node->body);
+            program.code[jump].arg = static_cast<int>(program.code.size());
+            break;
+        }
+        case NodeKind::WHILE: {
+            const auto* while_node = static_cast<const WhileNode*>(node);
+            int start = static_cast<int>(program.code.size());
+            size_t jump = emit_condition(while_node->condition);
+            emit_block(while_node->body);
+            emit(OpCode::JUMP, start);
+            program.code[jump].arg = static_cast<int>(program.code.size());
+            break;
+        }
+        case NodeKind::PARALLEL: {
+            const auto* parallel_node = static_cast<const ParallelNode*>(node);
+            ParallelLoop loop;
+            for (const Reduction* r = parallel_node->reductions_begin(); r != parallel_node->reductions_end(); ++r) {
+                loop.reductions.push_back({global(r->var_name), 0, r->op == "+" ? '+' : '*'});
+            }
+            std::map<std::string_view, int> slots;
+            loop.index = slots[parallel_node->index] = slot_count++;
+            for (std::string_view var : iteration_private_vars(parallel_node)) {
+                loop.privates.push_back(slots[var] = slot_count++);
+            }
+            for (size_t i = 0; i < parallel_node->reduction_count; ++i) {
+                loop.reductions[i].partial = slots[parallel_node->reductions[i].var_name] = slot_count++;
+            }
+            int id = static_cast<int>(program.parallel_loops.size());
+            program.parallel_loops.push_back(std::move(loop));
+
+            emit_expression(parallel_node->begin);
+            emit_expression(parallel_node->end);
+            emit(OpCode::PARALLEL_BEGIN, id);
+            int next = static_cast<int>(program.code.size());
+            size_t exit = emit(OpCode::PARALLEL_NEXT);
+            bool checked = check_shared_writes;
+            check_shared_writes = false;
+            private_slots.push_back(std::move(slots));
+            emit_block(parallel_node->body);
+            private_slots.pop_back();
+            check_shared_writes = checked;
+            emit(OpCode::JUMP, next);
+            program.code[exit].arg = static_cast<int>(program.code.size());
+            // The compiled loop checks before folding the reductions into the globals.
+            if (check_shared_writes && parallel_node->reduction_count > 0) emit(OpCode::CHECK_SHARED);
+            break;
+        }
+        case NodeKind::FUNC_CALL:
+            calls.emplace_back(emit(OpCode::CALL), static_cast<const FuncCallNode*>(node)->name);
+            emit(OpCode::POP);
+            break;
+        case NodeKind::RETURN:
+            // The generated C++ cannot return a MolObject from main() either.
+            if (!in_function) {
+                throw std::runtime_error("'퇴근' can only be used inside a function.");
+            }
+            emit_expression(static_cast<const ReturnNode*>(node)->expr);
+            emit(OpCode::RETURN);
+            break;
+        case NodeKind::FUNC_DEF:
+            throw std::runtime_error("Functions can only be defined at the top level.");
+        default:
+            throw std::runtime_error("Unsupported statement in bytecode compiler.");
+        }
+    }
+};
+
+// Deepest '캠프' recursion the VM allows. A compiled program overflows its 8 MB stack well
+// before this depth and dies with SIGSEGV; the VM raises an error instead of growing the call
+// stack until it runs out of memory.
+const size_t MAX_CALL_DEPTH = 1 << 20;
+
+// Executes a bytecode program. Runtime errors propagate as the same exceptions the compiled
+// executable would throw.
+void run_bytecode(const BytecodeProgram& program) {
+    std::vector<MolObject> globals(program.global_count);
+    std::vector<MolObject> stack;
+    std::vector<const Instruction*> call_stack;
+    stack.reserve(64);
+    // A running '몰몰' loop. Its slots are saved and restored, in case a function called from
+    // the body runs the same loop again.
+    struct ParallelFrame {
+        const ParallelLoop* loop;
+        long long next, end;
+        std::vector<MolObject> saved; // index, privates, then partials
+        bool was_parallel;
+    };
+    std::vector<ParallelFrame> parallel_frames;
+
+    const Instruction* code = program.code.data();
+    const Instruction* ip = code;
+
+#if defined(__GNUC__)
+    // Threaded dispatch: every handler jumps straight to the next one.
+    static void* const handlers[] = {
+        &&op_PUSH_CONST, &&op_LOAD, &&op_STORE, &&op_APPEND, &&op_ADD, &&op_MUL, &&op_LESS, &&op_LESS_EQUAL, &&op_EQUAL,
+        &&op_PRINT, &&op_INPUT, &&op_JUMP, &&op_JUMP_IF_FALSE,
+        &&op_JUMP_IF_NOT_LESS, &&op_JUMP_IF_NOT_LESS_EQUAL, &&op_JUMP_IF_NOT_EQUAL,
+        &&op_PARALLEL_BEGIN, &&op_PARALLEL_NEXT, &&op_CHECK_SHARED,
+        &&op_CALL, &&op_POP, &&op_RETURN, &&op_HALT
+    };
+#define VM_CASE(name) op_##name:
+#define VM_DISPATCH() goto *handlers[static_cast<int>(ip->op)]
+#define VM_JUMP(target) { ip = (target); VM_DISPATCH(); }
+    VM_DISPATCH();
+#else
+#define VM_CASE(name) case OpCode::name:
+#define VM_JUMP(target) { ip = (target); continue; }
+    for (;;) switch (ip->op) {
+#endif
+#define VM_NEXT() VM_JUMP(ip + 1)
+    VM_CASE(PUSH_CONST)
+        stack.push_back(program.constants[ip->arg]);
+        VM_NEXT();
+    VM_CASE(LOAD)
+        stack.push_back(globals[ip->arg]);
+        VM_NEXT();
+    VM_CASE(STORE)
+        globals[ip->arg] = std::move(stack.back());
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(APPEND)
+        mollang_append(globals[ip->arg], stack.back());
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(ADD)
+        stack[stack.size() - 2] = std::move(stack[stack.size() - 2]) + stack.back();
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(MUL)
+        stack[stack.size() - 2] = stack[stack.size() - 2] * stack.back();
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(LESS)
+        stack[stack.size() - 2] = stack[stack.size() - 2] < stack.back();
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(LESS_EQUAL)
+        stack[stack.size() - 2] = stack[stack.size() - 2] <= stack.back();
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(EQUAL)
+        stack[stack.size() - 2] = stack[stack.size() - 2] == stack.back();
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(PRINT)
+        mollang_print(stack.back());
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(INPUT)
+        stack.push_back(mollang_input());
+        VM_NEXT();
+    VM_CASE(JUMP)
+        VM_JUMP(code + ip->arg);
+    VM_CASE(JUMP_IF_FALSE) {
+        bool condition = mollang_truthy(stack.back());
+        stack.pop_back();
+        if (!condition) VM_JUMP(code + ip->arg);
+        VM_NEXT();
+    }
+#define VM_COMPARE_AND_BRANCH(compare) { \
+        bool condition = compare(stack[stack.size() - 2], stack.back()); \
+        stack.pop_back(); \
+        stack.pop_back(); \
+        if (!condition) VM_JUMP(code + ip->arg); \
+        VM_NEXT(); \
+    }
+    VM_CASE(JUMP_IF_NOT_LESS) VM_COMPARE_AND_BRANCH(mollang_less)
+    VM_CASE(JUMP_IF_NOT_LESS_EQUAL) VM_COMPARE_AND_BRANCH(mollang_less_equal)
+    VM_CASE(JUMP_IF_NOT_EQUAL) VM_COMPARE_AND_BRANCH(mollang_equal)
+#undef VM_COMPARE_AND_BRANCH
+    VM_CASE(PARALLEL_BEGIN) {
+        const ParallelLoop& loop = program.parallel_loops[ip->arg];
+        int first = stack[stack.size() - 2].as_int();
+        int last = stack.back().as_int();
+        stack.pop_back();
+        stack.pop_back();
+        ParallelFrame frame{&loop, first, last, {}, mollang_in_parallel};
+        frame.saved.push_back(std::move(globals[loop.index]));
+        for (int slot : loop.privates) frame.saved.push_back(std::move(globals[slot]));
+        for (const auto& r : loop.reductions) {
+            frame.saved.push_back(std::move(globals[r.partial]));
+            globals[r.partial] = mollang_reduction_identity(globals[r.target], r.op);
+        }
+        parallel_frames.push_back(std::move(frame));
+        mollang_in_parallel = true;
+        VM_NEXT();
+    }
+    VM_CASE(PARALLEL_NEXT) {
+        ParallelFrame& frame = parallel_frames.back();
+        const ParallelLoop& loop = *frame.loop;
+        if (frame.next < frame.end) {
+            globals[loop.index] = MolObject(static_cast<int>(frame.next++));
+            for (int slot : loop.privates) globals[slot] = MolObject();
+            VM_NEXT();
+        }
+        size_t saved = 0;
+        globals[loop.index] = std::move(frame.saved[saved++]);
+        for (int slot : loop.privates) globals[slot] = std::move(frame.saved[saved++]);
+        for (const auto& r : loop.reductions) {
+            mollang_reduce(globals[r.target], globals[r.partial], r.op);
+            globals[r.partial] = std::move(frame.saved[saved++]);
+        }
+        mollang_in_parallel = frame.was_parallel;
+        parallel_frames.pop_back();
+        VM_JUMP(code + ip->arg);
+    }
+    VM_CASE(CHECK_SHARED)
+        mollang_check_shared_write();
+        VM_NEXT();
+    VM_CASE(CALL)
+        if (call_stack.size() == MAX_CALL_DEPTH) throw std::runtime_error("Maximum call depth exceeded");
+        call_stack.push_back(ip + 1);
+        VM_JUMP(code + ip->arg);
+    VM_CASE(POP)
+        stack.pop_back();
+        VM_NEXT();
+    VM_CASE(RETURN) {
+        const Instruction* return_address = call_stack.back();
+        call_stack.pop_back();
+        VM_JUMP(return_address);
+    }
+    VM_CASE(HALT)
+        return;
+#if !defined(__GNUC__)
+    }
+#endif
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_JUMP
+#undef VM_DISPATCH
+}
+
+
+// --- Build Cache ---
+// Executables are cached under ~/.cache/mollang/<key>/, keyed on the source, the compiler
+// build, the runtime library and the g++ flags, so recompiling an unchanged script skips codegen and g++.
+const char* MOLLANG_VERSION = "0.2.0 (" __DATE__ " " __TIME__ ")";
+const std::string CXX_COMMAND = "g++ -std=c++17 -pthread";
+// The module exports a factory instead of running on load, so a page can supply '뭐먹' input
+// and collect '스크럼' output (see distribution/mollang_wasm.js). Runtime errors are C++
+// exceptions and need Emscripten's exception support to reach std::terminate.
+const std::string EMXX_COMMAND = "em++ -std=c++17";
+const std::string WASM_FLAGS = "-fexceptions -sMODULARIZE=1 -sEXPORT_NAME=createMollangProgram -sEXIT_RUNTIME=1"
+                               " -sALLOW_MEMORY_GROWTH=1 -sENVIRONMENT=web,worker,node";
+const std::uintmax_t DEFAULT_CACHE_MAX_BYTES = 256ull * 1024 * 1024;
+
+// Hashes the parts joined by '\0' separators, without building the joined string.
+std::string hash_hex(std::initializer_list<std::string_view> parts) {
+    // Two FNV-1a passes with different offset bases give a 128-bit key.
+    std::uint64_t h1 = 14695981039346656037ull;
+    std::uint64_t h2 = 0x6c62272e07bb0142ull;
+    auto add = [&](unsigned char c) {
+        h1 = (h1 ^ c) * 1099511628211ull;
+        h2 = (h2 ^ c) * 1099511628211ull;
+    };
+    bool first = true;
+    for (std::string_view part : parts) {
+        if (!first) add('\0');
+        first = false;
+        for (unsigned char c : part) add(c);
+    }
+    std::stringstream ss;
+    ss << std::hex;
+    for (std::uint64_t h : {h1, h2}) {
+        ss.width(16);
+        ss.fill('0');
+        ss << h;
+    }
+    return ss.str();
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("'" + path.string() + "' 파일을 열 수 없습니다.");
+    }
     std::stringstream buffer;
-    buffer << input_file.rdbuf();
-    std::string mollang_code = buffer.str();
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+std::string build_cache_key(std::string_view mollang_code, const std::string& runtime_key, const CompileOptions& options) {
+    std::string training = options.pgo_training.empty() ? "" : read_file(options.pgo_training);
+    return hash_hex({MOLLANG_VERSION, CXX_COMMAND, runtime_key, options.cache_tag(), training, mollang_code});
+}
+
+std::filesystem::path cache_root() {
+    if (const char* dir = std::getenv("MOLLANG_CACHE_DIR")) return dir;
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME")) return std::filesystem::path(xdg) / "mollang";
+    if (const char* home = std::getenv("HOME")) return std::filesystem::path(home) / ".cache" / "mollang";
+    return {};
+}
+
+std::uintmax_t cache_max_bytes() {
+    if (const char* mb = std::getenv("MOLLANG_CACHE_MAX_MB")) {
+        return std::strtoull(mb, nullptr, 10) * 1024 * 1024;
+    }
+    return DEFAULT_CACHE_MAX_BYTES;
+}
+
+// The cached executable for `key`, or an empty path on a miss.
+std::filesystem::path cache_lookup(const std::string& key) {
+    namespace fs = std::filesystem;
+    fs::path root = cache_root();
+    if (root.empty()) return {};
+    fs::path entry = root / key;
+    std::error_code ec;
+    if (!fs::exists(entry / "program", ec)) return {};
+    // Entries are evicted least-recently-used first.
+    fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+    return entry / "program";
+}
+
+// Copies a cached entry to the requested output files. Returns false on a miss.
+bool cache_fetch(const std::string& key, const std::string& cpp_filename, const std::string& exe_filename) {
+    namespace fs = std::filesystem;
+    fs::path program = cache_lookup(key);
+    if (program.empty()) return false;
+
+    std::error_code ec;
+    const auto overwrite = fs::copy_options::overwrite_existing;
+    fs::copy_file(program.parent_path() / "program.cpp", cpp_filename, overwrite, ec);
+    if (ec) return false;
+    fs::copy_file(program, exe_filename, overwrite, ec);
+    return !ec;
+}
+
+// Only executable entries, named by their hash_hex key, are evicted. The runtime library
+// builds, the server's sessions and other writers' staging directories share the root but
+// are in use or rebuilt at a cost, so they are neither counted nor removed.
+bool is_cache_entry(const std::filesystem::path& dir) {
+    std::string name = dir.filename().string();
+    return name.size() == 32 && name.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+void cache_evict(const std::filesystem::path& root, std::uintmax_t max_bytes) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+    std::map<fs::path, std::uintmax_t> sizes;
+    std::uintmax_t total = 0;
+    for (const auto& dir : fs::directory_iterator(root, ec)) {
+        if (!dir.is_directory(ec) || !is_cache_entry(dir.path())) continue;
+        std::uintmax_t size = 0;
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            std::uintmax_t file_size = file.file_size(ec);
+            if (!ec) size += file_size;
+        }
+        entries.emplace_back(fs::last_write_time(dir.path(), ec), dir.path());
+        sizes[dir.path()] = size;
+        total += size;
+    }
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries) {
+        if (total <= max_bytes) break;
+        fs::remove_all(entry.second, ec);
+        total -= sizes[entry.second];
+    }
+}
+
+// Stores freshly built outputs in the cache. Failures only cost a future cache miss.
+void cache_store(const std::string& key, const std::string& cpp_filename, const std::string& exe_filename) {
+    namespace fs = std::filesystem;
+    fs::path root = cache_root();
+    if (root.empty()) return;
+    std::error_code ec;
+    fs::path staging = root / (key + ".tmp" + std::to_string(std::random_device{}()));
+    fs::create_directories(staging, ec);
+    if (ec) return;
+    fs::copy_file(cpp_filename, staging / "program.cpp", ec);
+    if (!ec) fs::copy_file(exe_filename, staging / "program", ec);
+    if (!ec) fs::rename(staging, root / key, ec);
+    if (ec) {
+        fs::remove_all(staging, ec);
+        return;
+    }
+    cache_evict(root, cache_max_bytes());
+}
+
 
+// --- Runtime Library ---
+// Generated programs include mollang_runtime.hpp and link libmollang_runtime.a instead of
+// carrying the runtime inline. Both are built once per runtime version into the cache.
+std::string shell_quote(const std::filesystem::path& path) {
+    std::string quoted = "'";
+    for (char c : path.string()) {
+        quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+// Finds mollang_runtime.hpp/.cpp: $MOLLANG_RUNTIME_DIR, then next to the compiler executable.
+std::filesystem::path runtime_source_dir(const char* argv0) {
+    namespace fs = std::filesystem;
+    std::vector<fs::path> candidates;
+    if (const char* dir = std::getenv("MOLLANG_RUNTIME_DIR")) candidates.push_back(dir);
+    std::error_code ec;
+    fs::path self = fs::read_symlink("/proc/self/exe", ec);
+    if (!ec) candidates.push_back(self.parent_path());
+    candidates.push_back(fs::absolute(argv0, ec).parent_path());
+    candidates.push_back(fs::current_path(ec));
+    for (const auto& dir : candidates) {
+        if (fs::exists(dir / "mollang_runtime.hpp", ec) && fs::exists(dir / "mollang_runtime.cpp", ec)) {
+            return dir;
+        }
+    }
+    throw std::runtime_error("런타임(mollang_runtime.hpp/.cpp)을 찾을 수 없습니다. MOLLANG_RUNTIME_DIR을 설정하세요.");
+}
+
+std::string runtime_key(const std::filesystem::path& source_dir, BuildProfile profile) {
+    return hash_hex({CXX_COMMAND, build_flags(profile).compile, read_file(source_dir / "mollang_runtime.hpp"),
+                     read_file(source_dir / "mollang_runtime.cpp")});
+}
+
+// Returns the directory holding the built header, precompiled header and static library.
+std::filesystem::path prepare_runtime(const std::filesystem::path& source_dir, const std::string& key,
+                                      BuildProfile profile) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path root = cache_root();
+    if (root.empty()) root = fs::temp_directory_path(ec) / "mollang";
+    fs::path build_dir = root / ("runtime-" + key);
+    if (fs::exists(build_dir / "libmollang_runtime.a", ec)) return build_dir;
+
+    fs::path staging = root / ("runtime-" + key + ".tmp" + std::to_string(std::random_device{}()));
+    fs::create_directories(staging, ec);
+    fs::copy_file(source_dir / "mollang_runtime.hpp", staging / "mollang_runtime.hpp", ec);
+    if (!ec) fs::copy_file(source_dir / "mollang_runtime.cpp", staging / "mollang_runtime.cpp", ec);
+    if (ec) {
+        fs::remove_all(staging, ec);
+        throw std::runtime_error("런타임 빌드 디렉터리를 만들 수 없습니다: " + staging.string());
+    }
+
+    std::cout << "런타임 라이브러리 빌드 중: " << build_dir << std::endl;
+    std::string compiler = CXX_COMMAND + " " + build_flags(profile).compile;
+    const std::string commands[] = {
+        compiler + " -c " + shell_quote(staging / "mollang_runtime.cpp") + " -o " + shell_quote(staging / "mollang_runtime.o"),
+        "ar rcs " + shell_quote(staging / "libmollang_runtime.a") + " " + shell_quote(staging / "mollang_runtime.o"),
+        compiler + " -x c++-header " + shell_quote(staging / "mollang_runtime.hpp") + " -o " + shell_quote(staging / "mollang_runtime.hpp.gch"),
+    };
+    for (const auto& command : commands) {
+        if (system(command.c_str()) != 0) {
+            fs::remove_all(staging, ec);
+            throw std::runtime_error("런타임 라이브러리 빌드에 실패했습니다: " + command);
+        }
+    }
+
+    fs::rename(staging, build_dir, ec);
+    if (ec) {
+        // Another compiler process finished the same build first.
+        fs::remove_all(staging, ec);
+    }
+    return build_dir;
+}
+
+
+// --- Main Compiler Logic ---
+// The parser pulls tokens as it goes, so tokenizing is timed as part of "parse".
+NodeList parse_program(std::string_view mollang_code, Arena& arena, CompileStats* stats = nullptr) {
+    NodeList ast;
+    {
+        PhaseTimer timer(stats, "parse");
+        Parser parser(mollang_code, arena);
+        ast = parser.parse();
+        if (stats) stats->tokens = parser.tokens_read();
+    }
+    if (stats) {
+        stats->source_bytes = mollang_code.size();
+        for (const ASTNode* node : ast) stats->ast_nodes += count_nodes(node);
+    }
+    return ast;
+}
+
+// Runs the optimizer as one timed phase.
+void optimize_program(NodeList& ast, Arena& arena, int level, CompileStats* stats, bool inline_functions = true) {
+    {
+        PhaseTimer timer(stats, "optimize");
+        optimize(ast, arena, level, inline_functions);
+    }
+    if (stats) {
+        for (const ASTNode* node : ast) stats->optimized_ast_nodes += count_nodes(node);
+    }
+}
+
+// Compiles a program for the bytecode VM. Errors in the program throw.
+BytecodeProgram compile_to_bytecode(std::string_view mollang_code, const CompileOptions& options,
+                                    CompileStats* stats = nullptr) {
+    Arena arena;
+    NodeList ast = parse_program(mollang_code, arena, stats);
+    optimize_program(ast, arena, options.opt_level, stats);
+    check_reductions(ast, nullptr);
+    PhaseTimer timer(stats, "bytecode");
+    return BytecodeCompiler().compile(ast);
+}
+
+// Parses, optimizes and types a program for code generation. Tokens view mollang_code, and
+// every AST node is freed together with the arena.
+NodeList analyze_program(CompilationContext& ctx, std::string_view mollang_code, Arena& arena,
+                         const CompileOptions& options) {
+    // A context can be reused, but symbols never carry over between compilations.
+    ctx.reset();
+
+    NodeList ast = parse_program(mollang_code, arena, ctx.stats);
+    // A profiled build keeps every function, so each '캠프' gets its own counters. An
+    // incremental build keeps them too: a body copied into its callers would make an edit to
+    // one function recompile every unit that calls it.
+    optimize_program(ast, arena, options.opt_level, ctx.stats, !options.profile && !options.incremental);
+
+    // Populate symbol maps
+    {
+        PhaseTimer timer(ctx.stats, "collect_symbols");
+        for (const auto& node : ast) {
+            collect_symbols(ctx, node);
+        }
+    }
+    {
+        PhaseTimer timer(ctx.stats, "infer_types");
+        infer_types(ctx, ast);
+        check_reductions(ast, &ctx);
+    }
+    if (options.opt_level >= OPT_BASIC) {
+        PhaseTimer timer(ctx.stats, "analyze_loops");
+        LoopAnalysis(ctx).run(ast);
+    }
+    if (ctx.stats) {
+        ctx.stats->variables = ctx.variable_map.size();
+        ctx.stats->functions = ctx.function_map.size();
+    }
+    return ast;
+}
+
+// Translates a program and streams the generated C++ into `out`. Nothing is written if
+// parsing fails. All state lives in `ctx`, so translations with separate contexts can run
+// on different threads at the same time.
+void translate_to_cpp(CompilationContext& ctx, std::string_view mollang_code, std::ostream& out,
+                      const CompileOptions& options = {}) {
+    Arena arena;
+    NodeList ast = analyze_program(ctx, mollang_code, arena, options);
+    PhaseTimer timer(ctx.stats, "generate");
+    generate_cpp_code(ctx, ast, options, out);
+}
+
+// The program as the translation units of an --incremental build.
+std::vector<TranslationUnit> translate_to_cpp_units(CompilationContext& ctx, std::string_view mollang_code,
+                                                    const CompileOptions& options) {
+    ctx.stable_names = true;
+    Arena arena;
+    NodeList ast = analyze_program(ctx, mollang_code, arena, options);
+    PhaseTimer timer(ctx.stats, "generate");
+    return generate_cpp_units(ctx, ast, options);
+}
+
+std::string translate_to_cpp(CompilationContext& ctx, std::string_view mollang_code, const CompileOptions& options = {}) {
+    std::ostringstream ss;
+    translate_to_cpp(ctx, mollang_code, ss, options);
+    return ss.str();
+}
+
+// Runs a shell command. With `capture`, its stdout and stderr go there instead of the terminal.
+int run_command(const std::string& command, std::ostream* capture) {
+    if (!capture) return system(command.c_str());
+    FILE* pipe = popen((command + " 2>&1").c_str(), "r");
+    if (!pipe) return -1;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), pipe)) > 0) {
+        capture->write(chunk, static_cast<std::streamsize>(n));
+    }
+    return pclose(pipe);
+}
+
+// --incremental: each unit is compiled to an object file in <program>.build/ named after a
+// hash of its text and the compile flags. A rebuild compiles only the units whose text
+// changed, on parallel g++ processes, and relinks. Objects and sources no longer part of
+// the program are removed.
+bool build_incremental(std::string_view mollang_code, const CompileOptions& options,
+                       const std::filesystem::path& runtime_dir, const std::string& runtime_hash,
+                       const std::string& exe_filename, std::ostream& log, std::ostream* tool_output,
+                       CompileStats* stats) {
+    namespace fs = std::filesystem;
+    CompilationContext ctx;
+    ctx.stats = stats;
+    std::vector<TranslationUnit> units = translate_to_cpp_units(ctx, mollang_code, options);
+
+    std::error_code ec;
+    fs::path build_dir = exe_filename + ".build";
+    fs::create_directories(build_dir, ec);
+    if (ec) {
+        throw std::runtime_error("'" + build_dir.string() + "' 디렉터리를 만들 수 없습니다.");
+    }
+    std::filesystem::path runtime_build;
+    {
+        PhaseTimer timer(stats, "runtime", true);
+        runtime_build = prepare_runtime(runtime_dir, runtime_hash, options.build);
+    }
+    const BuildProfileFlags& flags = build_flags(options.build);
+
+    std::vector<fs::path> sources;
+    std::vector<fs::path> objects;
+    std::vector<size_t> outdated;
+    for (size_t i = 0; i < units.size(); ++i) {
+        sources.push_back(build_dir / (units[i].name + ".cpp"));
+        // An unchanged source keeps its timestamp.
+        if (!fs::exists(sources[i], ec) || read_file(sources[i]) != units[i].code) {
+            std::ofstream(sources[i], std::ios::binary) << units[i].code;
+        }
+        std::string key = hash_hex({CXX_COMMAND, flags.compile, runtime_hash, units[i].code});
+        objects.push_back(build_dir / (units[i].name + "-" + key.substr(0, 16) + ".o"));
+        if (!fs::exists(objects[i], ec)) outdated.push_back(i);
+    }
+    log << "Mollang 코드를 C++로 변환했습니다: " << build_dir.string() << " (" << units.size() << "개 파일 중 "
+        << outdated.size() << "개를 다시 컴파일합니다)" << std::endl;
+
+    PhaseTimer timer(stats, "g++", true);
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::vector<std::string> outputs(outdated.size());
+    auto worker = [&]() {
+        for (size_t i = next++; i < outdated.size(); i = next++) {
+            const fs::path& object = objects[outdated[i]];
+            fs::path staging = object.string() + ".tmp" + std::to_string(std::random_device{}());
+            std::string command = CXX_COMMAND + " " + flags.compile + " -I" + shell_quote(runtime_build) + " -c " +
+                                  shell_quote(sources[outdated[i]]) + " -o " + shell_quote(staging);
+            std::ostringstream capture;
+            std::error_code rename_ec;
+            if (run_command(command, tool_output ? &capture : nullptr) == 0) {
+                fs::rename(staging, object, rename_ec);
+            } else {
+                fs::remove(staging, rename_ec);
+                failed = true;
+            }
+            outputs[i] = capture.str();
+        }
+    };
+    std::vector<std::thread> workers;
+    size_t count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), outdated.size());
+    for (size_t i = 0; i < count; ++i) workers.emplace_back(worker);
+    for (auto& thread : workers) thread.join();
+    if (tool_output) {
+        for (const auto& output : outputs) *tool_output << output;
+    }
+    if (failed) return false;
+
+    std::set<fs::path> current(sources.begin(), sources.end());
+    current.insert(objects.begin(), objects.end());
+    for (const auto& entry : fs::directory_iterator(build_dir, ec)) {
+        std::string extension = entry.path().extension().string();
+        if ((extension == ".o" || extension == ".cpp") && !current.count(entry.path())) fs::remove(entry.path(), ec);
+    }
+
+    std::string link_command = CXX_COMMAND + " " + flags.compile + " -o " + exe_filename;
+    for (const auto& object : objects) link_command += " " + shell_quote(object);
+    link_command += " -L" + shell_quote(runtime_build) + " -lmollang_runtime";
+    if (*flags.link) link_command += std::string(" ") + flags.link;
+    if (options.static_link) link_command += " -static";
+    log << "링크 중: " << link_command << std::endl;
+    return run_command(link_command, tool_output) == 0;
+}
+
+// Writes the translation to `cpp_filename`, removing the file if translation throws.
+void write_cpp_file(std::string_view mollang_code, const CompileOptions& options, const std::string& cpp_filename,
+                    CompileStats* stats) {
+    std::ofstream cpp_file(cpp_filename);
+    if (!cpp_file) {
+        throw std::runtime_error("'" + cpp_filename + "' 파일을 생성할 수 없습니다.");
+    }
+    try {
+        CompilationContext ctx;
+        ctx.stats = stats;
+        translate_to_cpp(ctx, mollang_code, cpp_file, options);
+    } catch (...) {
+        // Don't leave an empty .cpp behind for a program that failed to parse.
+        cpp_file.close();
+        std::filesystem::remove(cpp_filename);
+        throw;
+    }
+}
+
+// --target=wasm: `<exe>.wasm` and its loader `<exe>.js`. The runtime library is compiled from
+// source with the program, since the prebuilt one is native code.
+bool build_wasm(const CompileOptions& options, const std::filesystem::path& runtime_dir,
+                const std::string& cpp_filename, const std::string& exe_filename, std::ostream& log,
+                std::ostream* tool_output, CompileStats* stats) {
+    std::string command = EMXX_COMMAND + " " + build_flags(options.build).compile + " " + WASM_FLAGS + " -I" +
+                          shell_quote(runtime_dir) + " -o " + shell_quote(exe_filename + ".js") + " " +
+                          shell_quote(cpp_filename) + " " + shell_quote(runtime_dir / "mollang_runtime.cpp");
+    log << "컴파일 중: " << command << std::endl;
+    PhaseTimer timer(stats, "em++", true);
+    return run_command(command, tool_output) == 0;
+}
+
+// Generates `cpp_filename` and compiles it with g++ into `exe_filename`, reporting progress
+// to `log`. With --pgo the program is built instrumented first, run once on the training
+// input and rebuilt with the collected profile. Translation errors throw; returns false if
+// g++ fails.
+bool build_executable(std::string_view mollang_code, const CompileOptions& options,
+                      const std::filesystem::path& runtime_dir, const std::string& runtime_hash,
+                      const std::string& cpp_filename, const std::string& exe_filename,
+                      std::ostream& log = std::cout, std::ostream* tool_output = nullptr,
+                      CompileStats* stats = nullptr) {
+    if (options.incremental) {
+        return build_incremental(mollang_code, options, runtime_dir, runtime_hash, exe_filename, log, tool_output, stats);
+    }
+    write_cpp_file(mollang_code, options, cpp_filename, stats);
+    log << "Mollang 코드를 C++로 변환했습니다: " << cpp_filename << std::endl;
+    if (options.target == Target::WASM) {
+        return build_wasm(options, runtime_dir, cpp_filename, exe_filename, log, tool_output, stats);
+    }
+
+    std::filesystem::path runtime_build;
+    {
+        PhaseTimer timer(stats, "runtime", true);
+        runtime_build = prepare_runtime(runtime_dir, runtime_hash, options.build);
+    }
+    const BuildProfileFlags& flags = build_flags(options.build);
+    auto compile_command = [&](const std::string& extra_flags) {
+        std::string command = CXX_COMMAND + " " + flags.compile + extra_flags + " -I" + shell_quote(runtime_build) +
+                              " -o " + exe_filename + " " + cpp_filename + " -L" + shell_quote(runtime_build) +
+                              " -lmollang_runtime";
+        if (*flags.link) command += std::string(" ") + flags.link;
+        if (options.static_link) command += " -static";
+        return command;
+    };
+    if (options.pgo_training.empty()) {
+        std::string command = compile_command("");
+        log << "컴파일 중: " << command << std::endl;
+        PhaseTimer timer(stats, "g++", true);
+        return run_command(command, tool_output) == 0;
+    }
+
+    // The profile file names are derived from the output and source names, so both builds
+    // must use the same ones.
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path profile_dir = fs::absolute(exe_filename + ".pgo", ec);
+    fs::remove_all(profile_dir, ec);
+    std::string instrumented = compile_command(" -fprofile-generate=" + shell_quote(profile_dir));
+    log << "프로파일 수집용 컴파일 중: " << instrumented << std::endl;
+    {
+        PhaseTimer timer(stats, "pgo-instrument", true);
+        if (run_command(instrumented, tool_output) != 0) {
+            fs::remove_all(profile_dir, ec);
+            return false;
+        }
+    }
+    std::string training_run = shell_quote(fs::absolute(exe_filename, ec)) + " < " + shell_quote(options.pgo_training) +
+                               " > /dev/null";
+    log << "학습 입력으로 실행 중: " << training_run << std::endl;
+    int status;
+    {
+        PhaseTimer timer(stats, "pgo-train", true);
+        status = run_command(training_run, tool_output);
+    }
+    if (status != 0) {
+        // A crashed run leaves no profile; the program is still built, just without it.
+        log << "경고: 학습 실행이 실패해 프로파일이 없거나 불완전할 수 있습니다." << std::endl;
+    }
+    std::string optimized = compile_command(" -fprofile-use=" + shell_quote(profile_dir) +
+                                            " -fprofile-correction -Wno-missing-profile");
+    log << "프로파일을 사용해 컴파일 중: " << optimized << std::endl;
+    PhaseTimer timer(stats, "g++", true);
+    bool ok = run_command(optimized, tool_output) == 0;
+    fs::remove_all(profile_dir, ec);
+    return ok;
+}
+
+// The text of a .mol file. Regular files are mapped read-only rather than read, so even a
+// very large script exists once in memory and the AST views the mapping directly; anything
+// that cannot be mapped (pipes, empty files) is read into a string instead. A file that may
+// change while it is in use (--watch polls one an editor is saving) is always read: a
+// mapping of a file truncated underneath it raises SIGBUS.
+class SourceText {
+public:
+    SourceText() = default;
+    SourceText(const SourceText&) = delete;
+    SourceText& operator=(const SourceText&) = delete;
+    ~SourceText() {
+        if (mapping) munmap(mapping, view.size());
+    }
+
+    bool open(const std::string& path, bool allow_mapping = true) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat info;
+        if (allow_mapping && fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            size_t size = static_cast<size_t>(info.st_size);
+            void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory != MAP_FAILED) {
+                madvise(memory, size, MADV_SEQUENTIAL);
+                mapping = memory;
+                view = std::string_view(static_cast<const char*>(memory), size);
+                ::close(fd);
+                return true;
+            }
+        }
+        char chunk[65536];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) > 0 || (n < 0 && errno == EINTR)) {
+            if (n > 0) owned.append(chunk, static_cast<size_t>(n));
+        }
+        ::close(fd);
+        if (n < 0) return false;
+        view = owned;
+        return true;
+    }
+
+    std::string_view text() const { return view; }
+
+private:
+    void* mapping = nullptr;
+    std::string owned;
+    std::string_view view;
+};
+
+// Opens a .mol source file. Returns false after reporting the problem to `err`.
+bool read_source_file(const std::string& input_filename, SourceText& source, std::ostream& err,
+                      bool allow_mapping = true) {
+    if (input_filename.size() <= 4 || input_filename.substr(input_filename.size() - 4) != ".mol") {
+        err << "오류: 입력 파일은 '.mol' 확장자여야 합니다." << std::endl;
+        return false;
+    }
+
+    if (!source.open(input_filename, allow_mapping)) {
+        err << "오류: '" << input_filename << "' 파일을 열 수 없습니다." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Compiles `input_filename` into an executable next to it, using the build cache when
+// allowed. Translation errors throw; returns false if g++ fails.
+bool compile_program(const std::string& input_filename, std::string_view mollang_code, const CompileOptions& options,
+                     bool use_cache, const std::filesystem::path& runtime_dir, const std::string& runtime_hash,
+                     std::ostream& log, std::ostream& err, std::ostream* tool_output,
+                     CompileStats* stats = nullptr) {
+    std::string output_basename = input_filename.substr(0, input_filename.size() - 4);
+    std::string cpp_filename = output_basename + ".cpp";
+    std::string exe_filename = output_basename;
+
+    // An incremental build keeps its own object files instead of using the executable cache,
+    // and the cache holds one executable per entry, not a module and its loader.
+    use_cache = use_cache && !options.incremental && options.target == Target::NATIVE;
+    std::string cache_key = build_cache_key(mollang_code, runtime_hash, options);
+    if (use_cache) {
+        bool hit;
+        {
+            PhaseTimer timer(stats, "cache");
+            hit = cache_fetch(cache_key, cpp_filename, exe_filename);
+        }
+        if (hit) {
+            log << "캐시된 빌드를 사용합니다: " << exe_filename << std::endl;
+            return true;
+        }
+    }
+
+    if (!build_executable(mollang_code, options, runtime_dir, runtime_hash, cpp_filename, exe_filename, log,
+                          tool_output, stats)) {
+        err << "컴파일 오류가 발생했습니다." << std::endl;
+        return false;
+    }
+    if (options.target == Target::WASM) {
+        log << "컴파일 성공! WebAssembly 모듈 생성: " << exe_filename << ".wasm (" << exe_filename << ".js)" << std::endl;
+    } else {
+        log << "컴파일 성공! 실행 파일 생성: " << exe_filename << std::endl;
+    }
+    if (use_cache) {
+        cache_store(cache_key, cpp_filename, exe_filename);
+    }
+    return true;
+}
+
+// Batch inputs: .mol files, directories searched recursively for .mol files, and '@list'
+// manifests naming one input per line ('#' starts a comment line).
+std::vector<std::string> expand_batch_inputs(const std::vector<std::string>& args) {
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+    for (const auto& arg : args) {
+        std::error_code ec;
+        if (arg.size() > 1 && arg[0] == '@') {
+            std::istringstream manifest(read_file(arg.substr(1)));
+            std::vector<std::string> listed;
+            std::string line;
+            while (std::getline(manifest, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty() && line[0] != '#') listed.push_back(line);
+            }
+            for (auto& file : expand_batch_inputs(listed)) files.push_back(std::move(file));
+        } else if (fs::is_directory(arg, ec)) {
+            std::vector<std::string> found;
+            for (const auto& entry : fs::recursive_directory_iterator(arg, ec)) {
+                if (entry.is_regular_file(ec) && entry.path().extension() == ".mol") found.push_back(entry.path().string());
+            }
+            std::sort(found.begin(), found.end());
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(arg);
+        }
+    }
+    return files;
+}
+
+// Compiles many programs on `jobs` worker threads. The runtime library is built once up
+// front, and each file's messages are printed together when it finishes.
+int compile_batch(const std::vector<std::string>& inputs, const CompileOptions& options, bool use_cache,
+                  unsigned jobs, const char* argv0) {
+    std::vector<std::string> files;
+    std::filesystem::path runtime_dir;
+    std::string runtime_hash;
+    try {
+        files = expand_batch_inputs(inputs);
+        runtime_dir = runtime_source_dir(argv0);
+        runtime_hash = runtime_key(runtime_dir, options.build);
+        if (options.target == Target::NATIVE) prepare_runtime(runtime_dir, runtime_hash, options.build);
+    } catch (const std::exception& e) {
+        std::cerr << "오류: " << e.what() << std::endl;
+        return 1;
+    }
+    if (files.empty()) {
+        std::cerr << "오류: 컴파일할 '.mol' 파일이 없습니다." << std::endl;
+        return 1;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+    std::mutex report_mutex;
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            std::ostringstream log;
+            bool ok = false;
+            SourceText source;
+            if (read_source_file(files[i], source, log)) {
+                try {
+                    ok = compile_program(files[i], source.text(), options, use_cache, runtime_dir, runtime_hash, log, log,
+                                         &log);
+                } catch (const std::exception& e) {
+                    log << "오류: " << e.what() << std::endl;
+                }
+            }
+            if (!ok) ++failed;
+            std::lock_guard<std::mutex> lock(report_mutex);
+            (ok ? std::cout : std::cerr) << "[" << (ok ? "성공" : "실패") << "] " << files[i] << '\n' << log.str()
+                                         << std::flush;
+        }
+    };
+    std::vector<std::thread> workers;
+    size_t count = std::min<size_t>(std::max(jobs, 1u), files.size());
+    for (size_t i = 0; i < count; ++i) workers.emplace_back(worker);
+    for (auto& thread : workers) thread.join();
+
+    std::cout << "일괄 컴파일 완료: " << files.size() << "개 중 " << files.size() - failed << "개 성공, " << failed
+              << "개 실패" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+// Native tier of '--tiered'. A cached native build of the program replaces this process right
+// away. On a miss it returns so the program can start in the bytecode VM at once, after
+// starting a detached background process that builds the executable into the cache for the
+// next run. Without the runtime sources or a cache only the VM tier is used.
+void start_native_tier(const char* argv0, std::string_view mollang_code, const CompileOptions& options) {
+    namespace fs = std::filesystem;
+    fs::path runtime_dir;
+    std::string runtime_hash;
+    try {
+        runtime_dir = runtime_source_dir(argv0);
+        runtime_hash = runtime_key(runtime_dir, options.build);
+    } catch (const std::exception&) {
+        return;
+    }
+    std::string key = build_cache_key(mollang_code, runtime_hash, options);
+    fs::path root = cache_root();
+    if (root.empty()) return;
+
+    std::string program = cache_lookup(key).string();
+    if (!program.empty()) {
+        std::cout.flush();
+        char* args[] = {const_cast<char*>(program.c_str()), nullptr};
+        execv(program.c_str(), args);
+        return; // could not start it; fall back to the VM
+    }
+
+    std::cout.flush();
+    pid_t child = fork();
+    if (child != 0) {
+        if (child > 0) waitpid(child, nullptr, 0);
+        return;
+    }
+    // The intermediate child exits at once, so the builder is reparented and never left as a
+    // zombie. It runs in its own session with no access to the program's stdio.
+    if (fork() != 0) _exit(0);
+    setsid();
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        for (int fd = 0; fd <= 2; ++fd) dup2(null_fd, fd);
+    }
     try {
-        std::string cpp_code = translate_to_cpp(mollang_code);
+        std::error_code ec;
+        fs::path staging = root / ("tier-" + key + ".tmp" + std::to_string(std::random_device{}()));
+        fs::create_directories(staging, ec);
+        std::string cpp_filename = (staging / "program.cpp").string();
+        std::string exe_filename = (staging / "program").string();
+        if (!ec && build_executable(mollang_code, options, runtime_dir, runtime_hash, cpp_filename, exe_filename)) {
+            cache_store(key, cpp_filename, exe_filename);
+        }
+        fs::remove_all(staging, ec);
+    } catch (...) {
+        // A failed background build only means the next run starts in the VM again.
+    }
+    _exit(0);
+}
+
+// --- Server and Watch Mode ---
+// `--serve` keeps one compiler resident for the playground and editors. The runtime library
+// is prepared once, bytecode for recently submitted sources stays in memory, and each
+// session's native builds reuse their --incremental object files, so a small edit costs a
+// parse, or a g++ run for the changed function, instead of a cold compiler and full build.
+const unsigned SERVE_TIME_LIMIT = 10;                   // seconds a submitted program may run
+const size_t SERVE_MAX_OUTPUT = 16 * 1024 * 1024;        // output bytes returned per run
+const size_t SERVE_MAX_REQUEST = 64 * 1024 * 1024;
+const size_t SERVE_CACHED_PROGRAMS = 64;
+
+// Runs `body` in a child process with `input` on stdin and its stdout and stderr collected
+// into `output`. The child is killed after `time_limit` seconds. Returns the wait status.
+int run_isolated(const std::string& input, unsigned time_limit, std::string& output, const std::function<void()>& body) {
+    FILE* input_file = std::tmpfile();
+    if (!input_file) throw std::runtime_error("임시 파일을 만들 수 없습니다.");
+    std::fwrite(input.data(), 1, input.size(), input_file);
+    std::fflush(input_file);
+    lseek(fileno(input_file), 0, SEEK_SET);
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        std::fclose(input_file);
+        throw std::runtime_error("파이프를 만들 수 없습니다.");
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        dup2(fileno(input_file), STDIN_FILENO);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        dup2(pipe_fds[1], STDERR_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        std::signal(SIGPIPE, SIG_DFL);
+        alarm(time_limit);
+        // An exception must not unwind into the server's loop; it terminates the child the
+        // way it terminates a compiled program.
+        [&]() noexcept { body(); }();
+        _exit(0);
+    }
+    close(pipe_fds[1]);
+    std::fclose(input_file);
+    if (child < 0) {
+        close(pipe_fds[0]);
+        throw std::runtime_error("프로세스를 만들 수 없습니다.");
+    }
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(pipe_fds[0], chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (output.size() < SERVE_MAX_OUTPUT) {
+            output.append(chunk, std::min(static_cast<size_t>(n), SERVE_MAX_OUTPUT - output.size()));
+        }
+    }
+    close(pipe_fds[0]);
+    int status = 0;
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR) {}
+    return status;
+}
+
+std::string describe_status(int status) {
+    if (WIFSIGNALED(status)) return "signal " + std::to_string(WTERMSIG(status));
+    return std::to_string(WEXITSTATUS(status));
+}
+
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> query;
+    std::map<std::string, std::string> headers; // by lowercase name
+    std::string body;
+};
+
+std::string url_decode(std::string_view text) {
+    std::string decoded;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            decoded += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            decoded += static_cast<char>(std::stoi(std::string(text.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            decoded += text[i];
+        }
+    }
+    return decoded;
+}
+
+// Reads one HTTP/1.x request. Returns false for a malformed or oversized one.
+bool read_http_request(int fd, HttpRequest& request) {
+    std::string data;
+    char chunk[65536];
+    size_t header_end;
+    while ((header_end = data.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || data.size() > SERVE_MAX_REQUEST) return false;
+        data.append(chunk, static_cast<size_t>(n));
+    }
+    std::istringstream head(data.substr(0, header_end));
+    std::string target;
+    head >> request.method >> target;
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if (question != std::string::npos) {
+        std::string_view query = std::string_view(target).substr(question + 1);
+        while (!query.empty()) {
+            std::string_view pair = query.substr(0, query.find('&'));
+            query.remove_prefix(std::min(query.size(), pair.size() + 1));
+            size_t equals = pair.find('=');
+            request.query[url_decode(pair.substr(0, equals))] =
+                equals == std::string_view::npos ? "" : url_decode(pair.substr(equals + 1));
+        }
+    }
+    std::string line;
+    std::getline(head, line);
+    while (std::getline(head, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        size_t value = line.find_first_not_of(" \t", colon + 1);
+        request.headers[name] = value == std::string::npos ? "" : line.substr(value);
+    }
+    auto content_length = request.headers.find("content-length");
+    size_t length = content_length == request.headers.end() ? 0 : std::strtoull(content_length->second.c_str(), nullptr, 10);
+    if (length > SERVE_MAX_REQUEST) return false;
+    request.body = data.substr(header_end + 4);
+    while (request.body.size() < length) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        request.body.append(chunk, static_cast<size_t>(n));
+    }
+    request.body.resize(length);
+    return true;
+}
+
+void write_http_response(int fd, int code, const char* reason, const std::string& body,
+                         const std::string& extra_headers = "", const char* content_type = "text/plain; charset=utf-8") {
+    std::string response = "HTTP/1.1 " + std::to_string(code) + " " + reason + "\r\n" +
+                           "Content-Type: " + content_type + "\r\n" +
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                           "Connection: close\r\n" + extra_headers + "\r\n" + body;
+    const char* data = response.data();
+    size_t size = response.size();
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+// A page on an allowed origin may call the server: http://127.0.0.1, localhost or [::1] on
+// any port, or an origin given with --allow-origin. Requests with any other Origin are
+// refused, and every request except a CORS preflight must carry the token printed at
+// startup in an X-Mollang-Token header or a token= query parameter, so that neither another
+// site nor another local user's page can run programs here.
+bool is_loopback_origin(std::string_view origin) {
+    for (std::string_view host : {"http://127.0.0.1", "http://localhost", "http://[::1]"}) {
+        if (origin.substr(0, host.size()) != host) continue;
+        std::string_view port = origin.substr(host.size());
+        if (port.empty()) return true;
+        return port.size() > 1 && port[0] == ':' && port.find_first_not_of("0123456789", 1) == std::string_view::npos;
+    }
+    return false;
+}
+
+std::string random_token() {
+    std::random_device random;
+    std::stringstream ss;
+    ss << std::hex;
+    for (int i = 0; i < 4; ++i) {
+        ss.width(8);
+        ss.fill('0');
+        ss << random();
+    }
+    return ss.str();
+}
+
+// Compares without an early exit, so response times do not reveal a prefix of the token.
+bool same_token(std::string_view given, std::string_view token) {
+    unsigned char difference = given.size() != token.size();
+    for (size_t i = 0; i < given.size() && i < token.size(); ++i) difference |= given[i] ^ token[i];
+    return difference == 0;
+}
+
+// Requests, one at a time:
+//   POST /compile              body: source; returns the generated C++
+//   POST /compile?target=wasm&session=..
+//                              body: source; builds the session's WebAssembly module and
+//                              returns its loader, which fetches GET /program.wasm?session=..
+//   POST /run?input=..&engine=vm|native&session=..
+//                              body: source; returns the program's output, exit status in
+//                              the X-Mollang-Exit header
+// Program errors are answered with 400 and the compiler's message.
+class CompileServer {
+public:
+    CompileServer(const char* argv0, const CompileOptions& options, std::vector<std::string> allowed_origins)
+        : options(options), allowed_origins(std::move(allowed_origins)), token(random_token()) {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        work_dir = cache_root();
+        if (work_dir.empty()) work_dir = fs::temp_directory_path(ec) / "mollang";
+        work_dir /= "serve";
+        try {
+            runtime_dir = runtime_source_dir(argv0);
+            runtime_hash = runtime_key(runtime_dir, options.build);
+            prepare_runtime(runtime_dir, runtime_hash, options.build);
+        } catch (const std::exception& e) {
+            std::cerr << "경고: " << e.what() << " 네이티브 실행은 사용할 수 없습니다." << std::endl;
+            runtime_hash.clear();
+        }
+    }
+
+    const std::string& access_token() const { return token; }
+
+    void handle(int fd) {
+        HttpRequest request;
+        cors_headers.clear();
+        if (!read_http_request(fd, request)) {
+            respond(fd, 400, "Bad Request", "잘못된 요청입니다.\n");
+            return;
+        }
+        auto origin = request.headers.find("origin");
+        if (origin != request.headers.end()) {
+            if (!is_loopback_origin(origin->second) &&
+                std::find(allowed_origins.begin(), allowed_origins.end(), origin->second) == allowed_origins.end()) {
+                respond(fd, 403, "Forbidden", "허용되지 않은 출처입니다: " + origin->second + "\n");
+                return;
+            }
+            cors_headers = "Access-Control-Allow-Origin: " + origin->second + "\r\n" +
+                           "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n" +
+                           "Access-Control-Allow-Headers: Content-Type, X-Mollang-Token\r\n" +
+                           "Access-Control-Expose-Headers: X-Mollang-Exit\r\n" + "Vary: Origin\r\n";
+        }
+        if (request.method == "OPTIONS") {
+            respond(fd, 204, "No Content", "");
+            return;
+        }
+        auto header_token = request.headers.find("x-mollang-token");
+        auto query_token = request.query.find("token");
+        std::string_view given = header_token != request.headers.end() ? std::string_view(header_token->second)
+                                 : query_token != request.query.end()  ? std::string_view(query_token->second)
+                                                                        : std::string_view();
+        if (!same_token(given, token)) {
+            respond(fd, 403, "Forbidden", "접근 토큰이 없거나 올바르지 않습니다.\n");
+            return;
+        }
+        try {
+            if (request.method == "GET" && request.path == "/") {
+                respond(fd, 200, "OK", "Mollang 서버가 실행 중입니다.\n");
+            } else if (request.method == "POST" && request.path == "/compile" &&
+                       request.query.count("target") && request.query.at("target") == "wasm") {
+                respond(fd, 200, "OK", wasm_loader_for(request.body, session_of(request)), "",
+                        "text/javascript; charset=utf-8");
+            } else if (request.method == "GET" && request.path == "/program.wasm") {
+                std::string module = read_file(session_dir(session_of(request)) / "program.wasm");
+                respond(fd, 200, "OK", module, "", "application/wasm");
+            } else if (request.method == "POST" && request.path == "/compile") {
+                CompilationContext ctx;
+                respond(fd, 200, "OK", translate_to_cpp(ctx, request.body, options));
+            } else if (request.method == "POST" && request.path == "/run") {
+                handle_run(fd, request);
+            } else {
+                respond(fd, 404, "Not Found", "알 수 없는 요청입니다: " + request.path + "\n");
+            }
+        } catch (const std::exception& e) {
+            respond(fd, 400, "Bad Request", std::string("오류: ") + e.what() + "\n");
+        }
+    }
+
+private:
+    CompileOptions options;
+    std::vector<std::string> allowed_origins; // besides loopback
+    std::string token;
+    std::string cors_headers; // for the request being answered
+    std::filesystem::path runtime_dir;
+    std::string runtime_hash; // empty without the runtime sources
+    std::filesystem::path work_dir;
+    std::map<std::string, BytecodeProgram> programs; // by hash of the source
+    std::deque<std::string> program_order;            // oldest first, for eviction
+    std::map<std::string, std::string> session_builds; // session -> key of its current executable
+
+    void respond(int fd, int code, const char* reason, const std::string& body, const std::string& extra_headers = "",
+                 const char* content_type = "text/plain; charset=utf-8") {
+        write_http_response(fd, code, reason, body, cors_headers + extra_headers, content_type);
+    }
+
+    const BytecodeProgram& bytecode_for(const std::string& source) {
+        std::string key = hash_hex({options.cache_tag(), source});
+        auto it = programs.find(key);
+        if (it != programs.end()) return it->second;
+        BytecodeProgram program = compile_to_bytecode(source, options);
+        if (programs.size() >= SERVE_CACHED_PROGRAMS) {
+            programs.erase(program_order.front());
+            program_order.pop_front();
+        }
+        program_order.push_back(key);
+        return programs.emplace(key, std::move(program)).first->second;
+    }
+
+    static std::string session_of(const HttpRequest& request) {
+        auto it = request.query.find("session");
+        return it == request.query.end() ? std::string() : it->second;
+    }
+
+    std::filesystem::path session_dir(const std::string& session) const {
+        std::string name;
+        for (char c : session) {
+            if (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_') name += c;
+        }
+        return work_dir / ("session-" + (name.empty() ? std::string("default") : name));
+    }
+
+    // Builds the session's program with `build` unless the last build had the same key.
+    // Returns the output path without extension.
+    std::string build_for_session(const std::string& source, const std::string& session, const CompileOptions& build) {
+        namespace fs = std::filesystem;
+        if (runtime_hash.empty()) throw std::runtime_error("런타임을 찾을 수 없어 컴파일할 수 없습니다.");
+        fs::path dir = session_dir(session);
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        std::string exe = (dir / "program").string();
+        std::string key = build_cache_key(source, runtime_hash, build);
+        auto it = session_builds.find(dir.string());
+        if (it != session_builds.end() && it->second == key) return exe;
+
+        std::ostringstream log;
+        session_builds.erase(dir.string());
+        if (!build_executable(source, build, runtime_dir, runtime_hash, (dir / "program.cpp").string(), exe, log,
+                              &log)) {
+            throw std::runtime_error("컴파일 오류가 발생했습니다.\n" + log.str());
+        }
+        session_builds[dir.string()] = key;
+        return exe;
+    }
+
+    // The session's executable, built incrementally.
+    std::string executable_for(const std::string& source, const std::string& session) {
+        CompileOptions incremental = options;
+        incremental.incremental = true;
+        return build_for_session(source, session, incremental);
+    }
 
-        std::string output_basename = input_filename.substr(0, input_filename.size() - 4);
-        std::string cpp_filename = output_basename + ".cpp";
-        std::string exe_filename = output_basename;
+    std::string wasm_loader_for(const std::string& source, const std::string& session) {
+        CompileOptions wasm = options;
+        wasm.target = Target::WASM;
+        return read_file(build_for_session(source, session, wasm) + ".js");
+    }
+
+    void handle_run(int fd, const HttpRequest& request) {
+        auto query = [&](const char* name) {
+            auto it = request.query.find(name);
+            return it == request.query.end() ? std::string() : it->second;
+        };
+        std::string input = query("input");
+        std::string output;
+        int status;
+        if (query("engine") == "native") {
+            std::string exe = executable_for(request.body, query("session"));
+            status = run_isolated(input, SERVE_TIME_LIMIT, output, [&]() {
+                execl(exe.c_str(), exe.c_str(), static_cast<char*>(nullptr));
+                _exit(127);
+            });
+        } else {
+            const BytecodeProgram& program = bytecode_for(request.body);
+            status = run_isolated(input, SERVE_TIME_LIMIT, output, [&]() {
+                mollang_init_output(false);
+                run_bytecode(program);
+                mollang_flush_output();
+            });
+        }
+        respond(fd, 200, "OK", output, "X-Mollang-Exit: " + describe_status(status) + "\r\n");
+    }
+};
 
-        std::ofstream cpp_file(cpp_filename);
-        if (!cpp_file) {
-            std::cerr << "오류: '" << cpp_filename << "' 파일을 생성할 수 없습니다." << std::endl;
+// Listens on 127.0.0.1:<port> for a numeric address, otherwise on the Unix socket at that
+// path. Only local clients can connect, since requests run arbitrary programs.
+int serve(const std::string& address, const CompileOptions& options, const std::vector<std::string>& allowed_origins,
+          const char* argv0) {
+    bool unix_socket = address.empty() || address.find_first_not_of("0123456789") != std::string::npos;
+    int fd = socket(unix_socket ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int bound = -1;
+    if (fd >= 0 && unix_socket) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (address.size() < sizeof(addr.sun_path)) {
+            std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+            unlink(address.c_str());
+            bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+    } else if (fd >= 0) {
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(address)));
+        bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    if (bound != 0 || listen(fd, 16) != 0) {
+        std::cerr << "오류: '" << address << "'에서 요청을 받을 수 없습니다: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    CompileServer server(argv0, options, allowed_origins);
+    std::cout << "Mollang 서버 시작: " << (unix_socket ? address : "http://127.0.0.1:" + address) << std::endl;
+    std::cout << "접근 토큰: " << server.access_token() << std::endl;
+    while (true) {
+        int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::cerr << "오류: " << std::strerror(errno) << std::endl;
             return 1;
         }
-        cpp_file << cpp_code;
-        cpp_file.close();
+        server.handle(client);
+        close(client);
+    }
+}
 
-        std::cout << "Mollang 코드를 C++로 변환했습니다: " << cpp_filename << std::endl;
+// --watch: rebuilds the program, or with --run reruns it in the VM, every time the file
+// changes. The file is polled, which also notices editors that save by replacing it.
+int watch(const std::string& input_filename, const CompileOptions& options, bool run_mode, bool use_cache,
+          const char* argv0) {
+    std::filesystem::path runtime_dir;
+    std::string runtime_hash;
+    if (!run_mode) {
+        try {
+            runtime_dir = runtime_source_dir(argv0);
+            runtime_hash = runtime_key(runtime_dir, options.build);
+        } catch (const std::exception& e) {
+            std::cerr << "오류: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::string last_key;
+    while (true) {
+        SourceText source;
+        if (read_source_file(input_filename, source, std::cerr, false)) {
+            std::string key = hash_hex({source.text()});
+            if (key != last_key) {
+                last_key = key;
+                std::cout << "--- " << input_filename << " ---" << std::endl;
+                try {
+                    if (run_mode) {
+                        BytecodeProgram program = compile_to_bytecode(source.text(), options);
+                        // The program runs in a child so a runtime error does not end the watch.
+                        pid_t child = fork();
+                        if (child == 0) {
+                            [&]() noexcept {
+                                mollang_init_output(options.line_buffered);
+                                run_bytecode(program);
+                                mollang_flush_output();
+                            }();
+                            _exit(0);
+                        }
+                        int status = 0;
+                        if (child > 0) waitpid(child, &status, 0);
+                    } else {
+                        compile_program(input_filename, source.text(), options, use_cache, runtime_dir, runtime_hash,
+                                        std::cout, std::cerr, nullptr);
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "오류: " << e.what() << std::endl;
+                }
+                std::cout << "변경을 기다리는 중... (Ctrl+C로 종료)" << std::endl;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+}
 
-        std::string compile_command = "g++ -std=c++17 -o " + exe_filename + " " + cpp_filename;
-        std::cout << "컴파일 중: " << compile_command << std::endl;
+// Benchmarks and other tools include this file for its passes and supply their own main.
+#ifndef MOLLANG_NO_MAIN
+int main(int argc, char* argv[]) {
+    bool run_mode = false;
+    bool tiered = false;
+    bool use_cache = true;
+    bool usage_error = false;
+    bool watch_mode = false;
+    std::string serve_address; // empty unless --serve
+    std::vector<std::string> allowed_origins;
+    const char* stats_format = nullptr; // "text" or "json"
+    unsigned jobs = std::thread::hardware_concurrency();
+    CompileOptions options;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--run") {
+            run_mode = true;
+        } else if (arg == "--tiered") {
+            run_mode = true;
+            tiered = true;
+        } else if (arg == "--no-cache") {
+            use_cache = false;
+        } else if (arg == "-O0") {
+            options.opt_level = OPT_NONE;
+        } else if (arg == "-O1") {
+            options.opt_level = OPT_BASIC;
+        } else if (arg == "--line-buffered") {
+            options.line_buffered = true;
+        } else if (arg == "--profile") {
+            options.profile = true;
+        } else if (arg.rfind("--build=", 0) == 0) {
+            usage_error = usage_error || !parse_build_profile(arg.substr(8), options.build);
+        } else if (arg == "--static") {
+            options.static_link = true;
+        } else if (arg == "--target=native" || arg == "--target=wasm") {
+            options.target = arg == "--target=wasm" ? Target::WASM : Target::NATIVE;
+        } else if (arg == "--incremental") {
+            options.incremental = true;
+        } else if (arg == "--pgo" || arg.rfind("--pgo=", 0) == 0) {
+            options.pgo_training = arg.size() > 5 ? arg.substr(6) : (i + 1 < argc ? argv[++i] : "");
+            usage_error = usage_error || options.pgo_training.empty();
+        } else if (arg == "--serve" || arg.rfind("--serve=", 0) == 0) {
+            serve_address = arg.size() > 7 ? arg.substr(8) : "7878";
+            usage_error = usage_error || serve_address.empty();
+        } else if (arg.rfind("--allow-origin=", 0) == 0) {
+            allowed_origins.push_back(arg.substr(15));
+            usage_error = usage_error || allowed_origins.back().empty();
+        } else if (arg == "--watch") {
+            watch_mode = true;
+        } else if (arg == "--stats" || arg == "--stats=text") {
+            stats_format = "text";
+        } else if (arg == "--stats=json") {
+            stats_format = "json";
+        } else if (arg.rfind("-j", 0) == 0) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            jobs = static_cast<unsigned>(std::strtoul(count.c_str(), nullptr, 10));
+            usage_error = usage_error || jobs == 0;
+        } else if (arg.rfind("--", 0) != 0) {
+            inputs.push_back(arg);
+        } else {
+            usage_error = true;
+        }
+    }
+    bool batch = inputs.size() > 1 ||
+                 (inputs.size() == 1 && (inputs[0][0] == '@' || std::filesystem::is_directory(inputs[0])));
+    // The VM has no profiling counters, so --profile only applies to native builds, and a
+    // --pgo training input belongs to one program. Profiling and PGO builds are built as a
+    // whole, not incrementally.
+    bool pgo = !options.pgo_training.empty();
+    if (!serve_address.empty()) {
+        // The server keeps its own caches and picks the engine per request.
+        if (usage_error || !inputs.empty() || run_mode || watch_mode || stats_format || options.profile || pgo ||
+            options.target != Target::NATIVE) {
+            std::cerr << "사용법: " << argv[0] << " --serve[=<포트|소켓_경로>] [--allow-origin=<출처>]... [-O0|-O1] [--build=<프로필>]"
+                      << std::endl;
+            return 1;
+        }
+        return serve(serve_address, options, allowed_origins, argv[0]);
+    }
+    // A WebAssembly module runs in a browser or Node.js, with portable code, its own runtime
+    // library build and no profile output file.
+    bool wasm = options.target == Target::WASM;
+    if (usage_error || inputs.empty() || (batch && (run_mode || stats_format || pgo || watch_mode)) ||
+        (watch_mode && (tiered || stats_format)) ||
+        (wasm && (run_mode || options.profile || pgo || options.incremental || options.static_link ||
+                  options.build == BuildProfile::NATIVE)) ||
+        (run_mode && (options.profile || pgo || options.incremental)) ||
+        (options.incremental && (options.profile || pgo))) {
+        std::cerr << "사용법: " << argv[0] << " [--run|--tiered|--profile|--pgo <학습_입력>|--incremental|--target=wasm] [--watch]"
+                  << " [--no-cache] [-O0|-O1] [--build=debug|release|native|size] [--static] [--line-buffered] [--stats[=json]]"
+                  << " <입력_파일.mol>" << std::endl;
+        std::cerr << "        " << argv[0] << " [--no-cache] [-O0|-O1] [--build=<프로필>] [--static] [--line-buffered]"
+                  << " [--profile|--incremental|--target=wasm] [-j<작업_수>] <파일|디렉터리|@목록>..." << std::endl;
+        std::cerr << "        " << argv[0] << " --serve[=<포트|소켓_경로>] [--allow-origin=<출처>]... [-O0|-O1] [--build=<프로필>]"
+                  << std::endl;
+        return 1;
+    }
+    if (batch) {
+        return compile_batch(inputs, options, use_cache, jobs, argv[0]);
+    }
 
-        int result = system(compile_command.c_str());
+    const std::string& input_filename = inputs[0];
+    if (watch_mode) {
+        return watch(input_filename, options, run_mode, use_cache, argv[0]);
+    }
+    SourceText source;
+    if (!read_source_file(input_filename, source, std::cerr)) {
+        return 1;
+    }
+    std::string_view mollang_code = source.text();
 
-        if (result == 0) {
-            std::cout << "컴파일 성공! 실행 파일 생성: " << exe_filename << std::endl;
+    // Statistics go to stderr so they never mix with a program's output.
+    CompileStats collected_stats;
+    CompileStats* stats = stats_format ? &collected_stats : nullptr;
+    auto report_stats = [&]() {
+        if (!stats) return;
+        if (std::strcmp(stats_format, "json") == 0) {
+            stats->write_json(std::cerr);
         } else {
-            std::cerr << "컴파일 오류가 발생했습니다." << std::endl;
+            stats->write_text(std::cerr);
+        }
+    };
+
+    if (run_mode) {
+        BytecodeProgram program;
+        try {
+            program = compile_to_bytecode(mollang_code, options, stats);
+        } catch (const std::exception& e) {
+            std::cerr << "오류: " << e.what() << std::endl;
+            return 1;
         }
+        if (tiered && use_cache) {
+            start_native_tier(argv[0], mollang_code, options);
+        }
+        // Runtime errors are deliberately left uncaught so the process terminates exactly
+        // like the compiled executable does.
+        mollang_init_output(options.line_buffered);
+        {
+            PhaseTimer timer(stats, "run");
+            run_bytecode(program);
+        }
+        mollang_flush_output();
+        report_stats();
+        return 0;
+    }
 
+    try {
+        std::filesystem::path runtime_dir = runtime_source_dir(argv[0]);
+        std::string runtime_hash = runtime_key(runtime_dir, options.build);
+        compile_program(input_filename, mollang_code, options, use_cache, runtime_dir, runtime_hash, std::cout,
+                        std::cerr, nullptr, stats);
     } catch (const std::exception& e) {
         std::cerr << "오류: " << e.what() << std::endl;
         return 1;
     }
+    report_stats();
 
     return 0;
 }
+#endif // MOLLANG_NO_MAIN
@@ -0,0 +1,29 @@
+// Runs a program built with `compiler --target=wasm`. The build's loader (<name>.js) defines
+// createMollangProgram; pass it here with the text for '뭐먹' and get back everything the
+// program printed with '스크럼', plus runtime errors, and its exit status.
+async function runMollangWasm(createMollangProgram, input = '', locateFile = undefined) {
+    const bytes = new TextEncoder().encode(input);
+    let position = 0;
+    let output = '';
+    let exit = 0;
+    const settings = {
+        stdin: () => (position < bytes.length ? bytes[position++] : null),
+        print: (line) => { output += line + '\n'; },
+        printErr: (line) => { output += line + '\n'; },
+        onExit: (code) => { exit = code; },
+    };
+    if (locateFile) settings.locateFile = locateFile;
+    try {
+        // main() runs to completion before the factory's promise settles.
+        await createMollangProgram(settings);
+    } catch (error) {
+        // An uncaught runtime error aborts the module.
+        output += `${error}\n`;
+        exit = 'abort';
+    }
+    return { output, exit };
+}
+
+if (typeof module !== 'undefined') {
+    module.exports = { runMollangWasm };
+}
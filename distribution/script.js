@@ -4,28 +4,85 @@ const output = document.getElementById('output');
 const inputData = document.getElementById('input-data');
 const submitButton = document.getElementById('submit-button');
 
+// With ?server=http://127.0.0.1:7878&token=<token> code runs on a local `compiler --serve`
+// daemon instead of the Pyodide interpreter; the token is the one the server prints at
+// startup. Add &engine=native to run it as a compiled executable there, or &engine=wasm to
+// have the server build a WebAssembly module that runs here in the page. Only a server on
+// this machine is accepted, since the wasm engine evaluates the loader it sends.
+const params = new URLSearchParams(window.location.search);
+const serverParam = params.get('server');
+const serverUrl = loopbackOrigin(serverParam);
+const serverToken = params.get('token') || '';
+const serverEngine = params.get('engine') || 'vm';
+const serverHeaders = { 'X-Mollang-Token': serverToken };
+const sessionId = Math.random().toString(36).slice(2);
+
+// The origin of `value` if it is an http:// URL on 127.0.0.1, localhost or [::1], else null.
+function loopbackOrigin(value) {
+    if (!value) return null;
+    try {
+        const url = new URL(value);
+        const loopback = ['127.0.0.1', 'localhost', '[::1]'].includes(url.hostname);
+        return url.protocol === 'http:' && loopback ? url.origin : null;
+    } catch {
+        return null;
+    }
+}
+
+async function runWasmFromServer(code, input) {
+    const query = new URLSearchParams({ target: 'wasm', session: sessionId });
+    const response = await fetch(`${serverUrl}/compile?${query}`,
+        { method: 'POST', headers: serverHeaders, body: code });
+    const loader = await response.text();
+    if (!response.ok) return loader;
+    const createMollangProgram = new Function(`${loader}\nreturn createMollangProgram;`)();
+    const result = await runMollangWasm(createMollangProgram, input,
+        (path) => `${serverUrl}/${path}?${new URLSearchParams({ session: sessionId, token: serverToken })}`);
+    return result.exit !== 0 ? `${result.output}\n[exit: ${result.exit}]` : result.output;
+}
+
+async function runOnServer(code, input) {
+    if (serverEngine === 'wasm') return runWasmFromServer(code, input);
+    const query = new URLSearchParams({ input, engine: serverEngine, session: sessionId });
+    const response = await fetch(`${serverUrl}/run?${query}`,
+        { method: 'POST', headers: serverHeaders, body: code });
+    const text = await response.text();
+    const exit = response.headers.get('X-Mollang-Exit');
+    return exit && exit !== '0' ? `${text}\n[exit: ${exit}]` : text;
+}
+
 async function main() {
-    output.textContent = 'Initializing Pyodide...';
-    let pyodide = await loadPyodide();
-    output.textContent += '\nPyodide loaded. Loading interpreter...';
+    if (serverParam && !serverUrl) {
+        output.textContent = `Refusing ?server=${serverParam}: only http://127.0.0.1, localhost or [::1] servers are allowed.`;
+        runButton.disabled = true;
+        return;
+    }
+    let runMollang;
+    if (serverUrl) {
+        runMollang = runOnServer;
+    } else {
+        output.textContent = 'Initializing Pyodide...';
+        let pyodide = await loadPyodide();
+        output.textContent += '\nPyodide loaded. Loading interpreter...';
+
+        const interpreterCode = await fetch('interpreter.py').then(res => res.text());
+        await pyodide.runPythonAsync(interpreterCode);
+        runMollang = pyodide.globals.get('run_mollang_code');
+    }
 
-    const interpreterCode = await fetch('interpreter.py').then(res => res.text());
-    await pyodide.runPythonAsync(interpreterCode);
-    
     output.textContent = 'Ready! Enter your Mol-Lang code and click Run.';
 
     let codeToRun = '';
     let isWaitingForInput = false;
 
-    function executeCode(input = '') {
+    async function executeCode(input = '') {
         if (!codeToRun.trim()) {
             output.textContent = 'Please enter some code to run.';
             return;
         }
         output.textContent = 'Running...';
         try {
-            const runMollang = pyodide.globals.get('run_mollang_code');
-            const result = runMollang(codeToRun, input);
+            const result = await runMollang(codeToRun, input);
             output.textContent = result;
         } catch (error) {
             output.textContent = `An error occurred in JavaScript:\n${error}`;
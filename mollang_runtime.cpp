@@ -0,0 +1,599 @@
+#include "mollang_runtime.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+
+void mollang_type_error(const char* op) {
+    throw std::runtime_error(std::string("Unsupported operand types for ") + op);
+}
+
+void mollang_bad_access() {
+    // Raised through std::get so the message matches what the std::variant-based MolObject
+    // printed for a non-bool condition.
+    std::variant<std::monostate, bool> none;
+    (void)std::get<bool>(none);
+    throw std::bad_variant_access();
+}
+
+MolObject::HeapString* MolObject::allocate(size_t capacity) {
+    void* memory = ::operator new(sizeof(HeapString) + capacity);
+    return new (memory) HeapString{{1}, 0, capacity};
+}
+
+void MolObject::init_string(std::string_view v) {
+    if (v.size() <= SMALL_CAPACITY) {
+        std::memcpy(storage, v.data(), v.size());
+        small_size = static_cast<unsigned char>(v.size());
+        tag = Tag::SMALL_STRING;
+        return;
+    }
+    HeapString* h = allocate(v.size());
+    std::memcpy(h->data(), v.data(), v.size());
+    h->size = v.size();
+    std::memcpy(storage, &h, sizeof(h));
+    small_size = 0;
+    tag = Tag::HEAP_STRING;
+}
+
+void MolObject::release_heap() noexcept {
+    HeapString* h = heap();
+    if (h->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        h->~HeapString();
+        ::operator delete(h);
+    }
+}
+
+void MolObject::append(std::string_view suffix) {
+    std::string_view current = as_string();
+    size_t size = current.size() + suffix.size();
+    if (tag == Tag::SMALL_STRING && size <= SMALL_CAPACITY) {
+        std::memmove(storage + small_size, suffix.data(), suffix.size());
+        small_size = static_cast<unsigned char>(size);
+        return;
+    }
+    bool owned = tag == Tag::HEAP_STRING && heap()->refs.load(std::memory_order_acquire) == 1;
+    if (owned && size <= heap()->capacity) {
+        HeapString* h = heap();
+        std::memmove(h->data() + h->size, suffix.data(), suffix.size());
+        h->size = size;
+        return;
+    }
+    // An owned buffer grows geometrically so a chain of appends to one value stays linear; a
+    // shared one is copied at its exact size. `suffix` may point into the old buffer, which is
+    // only released after the copy.
+    HeapString* grown = allocate(owned ? std::max(size, current.size() * 2) : size);
+    std::memcpy(grown->data(), current.data(), current.size());
+    std::memcpy(grown->data() + current.size(), suffix.data(), suffix.size());
+    grown->size = size;
+    release();
+    std::memcpy(storage, &grown, sizeof(grown));
+    small_size = 0;
+    tag = Tag::HEAP_STRING;
+}
+
+MolObject operator+(const MolObject& a, const MolObject& b) {
+    if (a.is_int() && b.is_int()) {
+        return MolObject(a.as_int() + b.as_int());
+    }
+    if (a.is_string() && b.is_string()) {
+        MolObject result(a);
+        result.append(b.as_string());
+        return result;
+    }
+    mollang_type_error("+");
+}
+
+MolObject operator+(MolObject&& a, const MolObject& b) {
+    if (a.is_string() && b.is_string()) {
+        a.append(b.as_string());
+        return std::move(a);
+    }
+    return static_cast<const MolObject&>(a) + b;
+}
+
+std::string mollang_concat(std::string_view a, std::string_view b) {
+    std::string s;
+    s.reserve(a.size() + b.size());
+    s.append(a);
+    s.append(b);
+    return s;
+}
+
+std::string mollang_repeat(std::string_view str, int count) {
+    std::string s;
+    if (count <= 0 || str.empty()) return s;
+    // Reserve once, then double the filled prefix: O(n) bytes copied in O(log count) steps.
+    size_t total = str.size() * static_cast<size_t>(count);
+    s.reserve(total);
+    s.append(str);
+    while (s.size() <= total / 2) {
+        s.append(s.data(), s.size());
+    }
+    s.append(s.data(), total - s.size());
+    return s;
+}
+
+MolObject& mollang_append(MolObject& target, const MolObject& suffix) {
+    if (target.is_string() && suffix.is_string()) {
+        target.append(suffix.as_string());
+    } else {
+        target = target + suffix;
+    }
+    return target;
+}
+
+MolObject operator*(const MolObject& a, const MolObject& b) {
+    if (a.is_string() && b.is_int()) {
+        return MolObject(mollang_repeat(a.as_string(), b.as_int()));
+    }
+    if (a.is_int() && b.is_int()) {
+        return MolObject(a.as_int() * b.as_int());
+    }
+    mollang_type_error("*");
+}
+
+MolObject operator<(const MolObject& a, const MolObject& b) {
+    return MolObject(mollang_less(a, b));
+}
+
+MolObject operator<=(const MolObject& a, const MolObject& b) {
+    return MolObject(mollang_less_equal(a, b));
+}
+
+MolObject operator==(const MolObject& a, const MolObject& b) {
+    return MolObject(mollang_equal(a, b));
+}
+
+// '스크럼' output goes through one large user-space buffer written straight to fd 1, so a
+// printing loop costs a memcpy per line instead of a flush. The buffer is emptied at exit,
+// before every '뭐먹' read, when the program dies from an uncaught error or SIGINT/SIGTERM,
+// and after every line in line-buffered mode.
+namespace {
+
+// Only uses write(), so it is also safe to call from a signal handler.
+void write_all(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(STDOUT_FILENO, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+struct OutputBuffer {
+    static constexpr size_t CAPACITY = 64 * 1024;
+    char data[CAPACITY];
+    size_t size = 0;
+    bool line_buffered = false;
+    volatile std::sig_atomic_t flushing = 0; // a signal handler must not write the same bytes again
+
+    ~OutputBuffer() { flush(); }
+
+    void flush() {
+        flushing = 1;
+        write_all(data, size);
+        size = 0;
+        flushing = 0;
+    }
+
+    void write(std::string_view text) {
+        if (text.size() > CAPACITY - size) {
+            flush();
+            if (text.size() > CAPACITY) {
+                write_all(text.data(), text.size());
+                return;
+            }
+        }
+        std::memcpy(data + size, text.data(), text.size());
+        size += text.size();
+    }
+
+    void end_line() {
+        if (size == CAPACITY) flush();
+        data[size++] = '\n';
+        if (line_buffered) flush();
+    }
+};
+
+OutputBuffer output;
+thread_local std::string* chunk_output = nullptr; // set while this thread runs a '몰몰' chunk
+std::terminate_handler previous_terminate = nullptr;
+
+void flush_then_terminate() {
+    output.flush();
+    if (previous_terminate) previous_terminate();
+    std::abort();
+}
+
+void flush_then_reraise(int signal_number) {
+    if (!output.flushing) output.flush();
+    std::signal(signal_number, SIG_DFL);
+    std::raise(signal_number);
+}
+
+// A crash keeps its default outcome (exit status, core dump) once the buffered output is
+// written. The handler runs on its own stack, so a stack overflow from deep recursion in a
+// native program still flushes; only the main thread has one, as only it runs deep calls.
+alignas(16) char crash_stack[64 * 1024];
+
+void install_crash_handlers() {
+    stack_t stack{};
+    stack.ss_sp = crash_stack;
+    stack.ss_size = sizeof(crash_stack);
+    sigaltstack(&stack, nullptr);
+    struct sigaction action{};
+    action.sa_handler = flush_then_reraise;
+    action.sa_flags = SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int signal_number : {SIGSEGV, SIGBUS, SIGABRT}) sigaction(signal_number, &action, nullptr);
+}
+
+void print_line(std::string_view text) {
+    if (chunk_output) {
+        chunk_output->append(text);
+        chunk_output->push_back('\n');
+        return;
+    }
+    output.write(text);
+    output.end_line();
+}
+
+} // namespace
+
+void mollang_init_output(bool line_buffered) {
+    std::cout.flush(); // anything the host program already printed comes first
+    output.line_buffered = line_buffered;
+    previous_terminate = std::set_terminate(flush_then_terminate);
+    std::signal(SIGINT, flush_then_reraise);
+    std::signal(SIGTERM, flush_then_reraise);
+    install_crash_handlers();
+}
+
+void mollang_flush_output() { output.flush(); }
+
+void mollang_print(const MolObject& obj) {
+    if (obj.is_int()) {
+        mollang_print(obj.as_int());
+    } else if (obj.is_string()) {
+        mollang_print(obj.as_string());
+    } else if (obj.is_bool()) {
+        mollang_print(obj.as_bool());
+    } else {
+        print_line({});
+    }
+}
+
+void mollang_print(int v) {
+    char digits[16];
+    auto result = std::to_chars(digits, digits + sizeof(digits), v);
+    print_line(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+void mollang_print(std::string_view v) { print_line(v); }
+
+void mollang_print(bool v) { print_line(v ? "true" : "false"); }
+
+// '뭐먹' reads stdin through its own buffer filled by large read() calls, and most lines are
+// parsed straight out of that buffer without copying.
+namespace {
+
+struct InputBuffer {
+    static constexpr size_t CAPACITY = 64 * 1024;
+    char data[CAPACITY];
+    size_t begin = 0;
+    size_t end = 0;
+    bool eof = false;
+    std::string spill; // a line that crosses a refill is assembled here
+
+    bool refill() {
+        while (!eof) {
+            ssize_t n = ::read(STDIN_FILENO, data, CAPACITY);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                eof = true;
+                break;
+            }
+            begin = 0;
+            end = static_cast<size_t>(n);
+            return true;
+        }
+        return false;
+    }
+
+    // The next line without its '\n', like std::getline; empty at end of input. The view is
+    // valid until the next call.
+    std::string_view read_line() {
+        if (begin == end && !refill()) return {};
+        const char* start = data + begin;
+        if (const void* newline = std::memchr(start, '\n', end - begin)) {
+            size_t length = static_cast<const char*>(newline) - start;
+            begin += length + 1;
+            return std::string_view(start, length);
+        }
+        spill.assign(start, end - begin);
+        begin = end;
+        while (refill()) {
+            start = data + begin;
+            if (const void* newline = std::memchr(start, '\n', end - begin)) {
+                size_t length = static_cast<const char*>(newline) - start;
+                spill.append(start, length);
+                begin += length + 1;
+                break;
+            }
+            spill.append(start, end - begin);
+            begin = end;
+        }
+        return spill;
+    }
+};
+
+InputBuffer input;
+
+// Same rules as std::stoi, without exceptions for non-numbers: leading whitespace, an optional
+// sign and at least one digit, ignoring anything after the digits. Out-of-range numbers still
+// throw std::out_of_range like stoi did.
+bool parse_int(std::string_view text, int& value) {
+    const char* first = text.data();
+    const char* last = first + text.size();
+    while (first != last && std::isspace(static_cast<unsigned char>(*first))) ++first;
+    if (first != last && *first == '+') {
+        ++first;
+        if (first == last || !std::isdigit(static_cast<unsigned char>(*first))) return false;
+    }
+    auto result = std::from_chars(first, last, value);
+    if (result.ec == std::errc::result_out_of_range) throw std::out_of_range("stoi");
+    return result.ec == std::errc();
+}
+
+} // namespace
+
+MolObject mollang_input() {
+    if (mollang_in_parallel) throw std::runtime_error("'뭐먹' cannot be used inside a parallel loop");
+    output.flush(); // a prompt printed before the read must be visible
+    std::string_view line = input.read_line();
+    int value;
+    if (parse_int(line, value)) return MolObject(value);
+    return MolObject(line);
+}
+
+thread_local bool mollang_in_parallel = false;
+
+void mollang_shared_write_error() {
+    throw std::runtime_error("Unsafe write to a shared variable inside a parallel loop");
+}
+
+namespace {
+
+size_t thread_count() {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    return 1;
+#else
+    static const size_t count = [] {
+        const char* configured = std::getenv("MOLLANG_THREADS");
+        long n = configured && *configured ? std::strtol(configured, nullptr, 10) : 0;
+        if (n <= 0) n = static_cast<long>(std::thread::hardware_concurrency());
+        return static_cast<size_t>(std::clamp(n, 1L, 256L));
+    }();
+    return count;
+#endif
+}
+
+class ParallelScope {
+public:
+    ParallelScope() : was_parallel(mollang_in_parallel) { mollang_in_parallel = true; }
+    ~ParallelScope() { mollang_in_parallel = was_parallel; }
+    ParallelScope(const ParallelScope&) = delete;
+    ParallelScope& operator=(const ParallelScope&) = delete;
+
+private:
+    bool was_parallel;
+};
+
+// thread_count() - 1 workers plus the calling thread, each with a queue of chunk numbers. A
+// thread takes chunks from the front of its own queue and, once that is empty, steals from
+// the back of the others'. Started on the first loop that needs it and never torn down, so
+// exit does not wait for workers sleeping on the condition variable.
+class ThreadPool {
+public:
+    static ThreadPool& instance() {
+        static ThreadPool* pool = new ThreadPool(thread_count());
+        return *pool;
+    }
+
+    // Calls task(chunk) for every chunk below `count` and returns when all have finished.
+    void run(size_t count, void (*task)(void*, size_t), void* context) {
+        std::lock_guard<std::mutex> running(run_mutex);
+        for (size_t chunk = 0; chunk < count; ++chunk) {
+            Queue& queue = queues[chunk % size];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.chunks.push_back(chunk);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current_task = task;
+            current_context = context;
+            busy = size - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return busy == 0; });
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> chunks;
+    };
+
+    size_t size;
+    std::unique_ptr<Queue[]> queues;
+    std::mutex run_mutex; // one loop at a time, should a host program start several
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::uint64_t generation = 0;
+    size_t busy = 0;
+    void (*current_task)(void*, size_t) = nullptr;
+    void* current_context = nullptr;
+
+    explicit ThreadPool(size_t size) : size(size), queues(new Queue[size]) {
+        for (size_t id = 1; id < size; ++id) std::thread([this, id] { worker(id); }).detach();
+    }
+
+    void worker(size_t id) {
+        mollang_in_parallel = true;
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&] { return generation != seen; });
+            seen = generation;
+            lock.unlock();
+            work(id);
+            lock.lock();
+            if (--busy == 0) done.notify_one();
+        }
+    }
+
+    void work(size_t id) {
+        size_t chunk;
+        while (take(id, chunk)) current_task(current_context, chunk);
+    }
+
+    bool take(size_t id, size_t& chunk) {
+        for (size_t k = 0; k < size; ++k) {
+            Queue& queue = queues[(id + k) % size];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.chunks.empty()) continue;
+            if (k == 0) {
+                chunk = queue.chunks.front();
+                queue.chunks.pop_front();
+            } else {
+                chunk = queue.chunks.back();
+                queue.chunks.pop_back();
+            }
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+MolParallelLoop::MolParallelLoop(int begin, int end, bool serial) : begin(begin), end(end), chunk_count(0) {
+    long long iterations = static_cast<long long>(end) - begin;
+    if (iterations <= 0) return;
+    size_t threads = thread_count();
+    if (serial || mollang_in_parallel || threads == 1) {
+        chunk_count = 1;
+    } else {
+        chunk_count = static_cast<size_t>(std::min<long long>(iterations, static_cast<long long>(threads) * 8));
+    }
+}
+
+void MolParallelLoop::run_chunks(void (*call)(void*, size_t, int, int), void* context) {
+    if (chunk_count == 0) return;
+    ParallelScope scope;
+    if (chunk_count == 1) {
+        call(context, 0, begin, end);
+        return;
+    }
+
+    struct Run {
+        MolParallelLoop* loop;
+        void (*call)(void*, size_t, int, int);
+        void* context;
+        std::vector<std::string> outputs;
+        std::vector<std::exception_ptr> errors;
+        std::atomic<size_t> first_error;
+
+        int first(size_t chunk) const {
+            long long iterations = static_cast<long long>(loop->end) - loop->begin;
+            return static_cast<int>(loop->begin + iterations * static_cast<long long>(chunk) /
+                                                      static_cast<long long>(loop->chunk_count));
+        }
+    } run{this, call, context, std::vector<std::string>(chunk_count),
+          std::vector<std::exception_ptr>(chunk_count), {chunk_count}};
+
+    ThreadPool::instance().run(chunk_count, [](void* state, size_t chunk) {
+        Run& run = *static_cast<Run*>(state);
+        // Chunks after a failed one are not needed: their output would never be written.
+        if (chunk > run.first_error.load(std::memory_order_relaxed)) return;
+        chunk_output = &run.outputs[chunk];
+        try {
+            run.call(run.context, chunk, run.first(chunk), run.first(chunk + 1));
+        } catch (...) {
+            run.errors[chunk] = std::current_exception();
+            size_t failed = run.first_error.load(std::memory_order_relaxed);
+            while (chunk < failed && !run.first_error.compare_exchange_weak(failed, chunk)) {
+            }
+        }
+        chunk_output = nullptr;
+    }, &run);
+
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        output.write(run.outputs[chunk]);
+        if (run.errors[chunk]) {
+            if (output.line_buffered) output.flush();
+            std::rethrow_exception(run.errors[chunk]);
+        }
+    }
+    if (output.line_buffered) output.flush();
+}
+
+// The flat profile lists every site, most expensive first, with its share of the run time.
+namespace {
+
+MolProfileSite* profile_sites = nullptr;
+size_t profile_site_count = 0;
+std::uint64_t profile_start = 0;
+
+void write_profile() {
+    std::uint64_t total = mollang_cycles() - profile_start;
+    const char* path = std::getenv("MOLLANG_PROFILE_OUT");
+    std::FILE* file = std::fopen(path && *path ? path : "mollang_profile.txt", "w");
+    if (!file) return;
+    std::vector<const MolProfileSite*> order;
+    for (size_t i = 0; i < profile_site_count; ++i) order.push_back(&profile_sites[i]);
+    std::stable_sort(order.begin(), order.end(), [](const MolProfileSite* a, const MolProfileSite* b) {
+        return a->cycles > b->cycles;
+    });
+    std::fprintf(file, "# Mollang flat profile: %" PRIu64 " cycles in total, times include nested code\n", total);
+    std::fprintf(file, "#  %%time           cycles       entries    iterations  site\n");
+    for (const MolProfileSite* site : order) {
+        double share = total ? 100.0 * static_cast<double>(site->cycles) / static_cast<double>(total) : 0.0;
+        std::fprintf(file, "%7.2f %16" PRIu64 " %13" PRIu64 " %13" PRIu64 "  %s %d:%d\n", share, site->cycles,
+                     site->entries, site->iterations, site->label, site->line, site->column);
+    }
+    std::fclose(file);
+}
+
+} // namespace
+
+void mollang_profile_init(MolProfileSite* sites, size_t count) {
+    profile_sites = sites;
+    profile_site_count = count;
+    profile_start = mollang_cycles();
+    std::atexit(write_profile);
+}
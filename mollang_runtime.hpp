@@ -0,0 +1,309 @@
+// Mollang runtime shared by compiled programs and the compiler's bytecode VM.
+// The compiler builds it once into a static library and a precompiled header.
+#ifndef MOLLANG_RUNTIME_HPP
+#define MOLLANG_RUNTIME_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+[[noreturn]] void mollang_type_error(const char* op);
+[[noreturn]] void mollang_bad_access();
+
+// Mollang's dynamic value: none, int, bool or string in a 16-byte tagged representation.
+// Ints, bools and strings of up to SMALL_CAPACITY bytes are stored inline; longer strings
+// live in an immutable reference-counted heap buffer, so copying a value never allocates.
+class MolObject {
+public:
+    static constexpr size_t SMALL_CAPACITY = 14;
+
+    MolObject() noexcept : small_size(0), tag(Tag::NONE) {}
+    MolObject(int v) noexcept : small_size(0), tag(Tag::INT) { std::memcpy(storage, &v, sizeof(v)); }
+    MolObject(bool v) noexcept : small_size(0), tag(Tag::BOOL) { storage[0] = v; }
+    explicit MolObject(std::string_view v) { init_string(v); }
+    explicit MolObject(const std::string& v) { init_string(v); }
+    explicit MolObject(const char* v) { init_string(v); }
+
+    MolObject(const MolObject& other) noexcept : small_size(other.small_size), tag(other.tag) {
+        std::memcpy(storage, other.storage, sizeof(storage));
+        if (tag == Tag::HEAP_STRING) heap()->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    MolObject(MolObject&& other) noexcept : small_size(other.small_size), tag(other.tag) {
+        std::memcpy(storage, other.storage, sizeof(storage));
+        other.tag = Tag::NONE;
+    }
+    MolObject& operator=(const MolObject& other) noexcept {
+        MolObject copy(other);
+        return *this = std::move(copy);
+    }
+    MolObject& operator=(MolObject&& other) noexcept {
+        if (this != &other) {
+            release();
+            std::memcpy(storage, other.storage, sizeof(storage));
+            small_size = other.small_size;
+            tag = other.tag;
+            other.tag = Tag::NONE;
+        }
+        return *this;
+    }
+    ~MolObject() { release(); }
+
+    bool is_none() const { return tag == Tag::NONE; }
+    bool is_int() const { return tag == Tag::INT; }
+    bool is_bool() const { return tag == Tag::BOOL; }
+    bool is_string() const { return tag == Tag::SMALL_STRING || tag == Tag::HEAP_STRING; }
+
+    // Accessors throw std::bad_variant_access on a type mismatch, like std::get did.
+    int as_int() const {
+        if (tag != Tag::INT) mollang_bad_access();
+        int v;
+        std::memcpy(&v, storage, sizeof(v));
+        return v;
+    }
+    bool as_bool() const {
+        if (tag != Tag::BOOL) mollang_bad_access();
+        return storage[0] != 0;
+    }
+    std::string_view as_string() const {
+        if (tag == Tag::SMALL_STRING) return std::string_view(storage, small_size);
+        if (tag != Tag::HEAP_STRING) mollang_bad_access();
+        const HeapString* h = heap();
+        return std::string_view(h->data(), h->size);
+    }
+
+    // Appends to a string value. The buffer is extended in place when this value is its only
+    // owner, which makes building a string through repeated `+` on temporaries linear.
+    void append(std::string_view suffix);
+
+private:
+    enum class Tag : unsigned char { NONE, INT, BOOL, SMALL_STRING, HEAP_STRING };
+
+    struct HeapString {
+        std::atomic<size_t> refs;
+        size_t size;
+        size_t capacity;
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    // Inline int/bool/small string bytes, or the HeapString pointer.
+    alignas(8) char storage[SMALL_CAPACITY] = {};
+    unsigned char small_size;
+    Tag tag;
+
+    HeapString* heap() const {
+        HeapString* h;
+        std::memcpy(&h, storage, sizeof(h));
+        return h;
+    }
+
+    static HeapString* allocate(size_t capacity);
+    void init_string(std::string_view v);
+    void release_heap() noexcept;
+    void release() noexcept {
+        if (tag == Tag::HEAP_STRING) release_heap();
+    }
+};
+
+static_assert(sizeof(MolObject) == 16, "MolObject should stay two words");
+
+// Comparisons used directly as '입'/'몰' conditions. They return a plain bool, so a loop test
+// is a single compare instead of building a MolObject(bool) and unpacking it again. Operands
+// the compiler knows to be ints or strings are passed unboxed.
+inline bool mollang_truthy(const MolObject& obj) { return obj.as_bool(); }
+
+inline bool mollang_less(const MolObject& a, int b) {
+    if (!a.is_int()) mollang_type_error("<");
+    return a.as_int() < b;
+}
+inline bool mollang_less(int a, const MolObject& b) {
+    if (!b.is_int()) mollang_type_error("<");
+    return a < b.as_int();
+}
+inline bool mollang_less(const MolObject& a, const MolObject& b) {
+    if (!b.is_int()) mollang_type_error("<");
+    return mollang_less(a, b.as_int());
+}
+
+inline bool mollang_less_equal(const MolObject& a, int b) {
+    if (!a.is_int()) mollang_type_error("<=");
+    return a.as_int() <= b;
+}
+inline bool mollang_less_equal(int a, const MolObject& b) {
+    if (!b.is_int()) mollang_type_error("<=");
+    return a <= b.as_int();
+}
+inline bool mollang_less_equal(const MolObject& a, const MolObject& b) {
+    if (!b.is_int()) mollang_type_error("<=");
+    return mollang_less_equal(a, b.as_int());
+}
+
+// Values of different types compare as not equal.
+inline bool mollang_equal(const MolObject& a, int b) { return a.is_int() && a.as_int() == b; }
+inline bool mollang_equal(int a, const MolObject& b) { return mollang_equal(b, a); }
+inline bool mollang_equal(const MolObject& a, std::string_view b) { return a.is_string() && a.as_string() == b; }
+inline bool mollang_equal(std::string_view a, const MolObject& b) { return mollang_equal(b, a); }
+inline bool mollang_equal(const MolObject& a, const MolObject& b) {
+    if (b.is_int()) return mollang_equal(a, b.as_int());
+    if (b.is_string()) return mollang_equal(a, b.as_string());
+    return false;
+}
+
+// Overloads for operators. The rvalue overloads reuse the left operand's string buffer.
+MolObject operator+(const MolObject& a, const MolObject& b);
+MolObject operator+(MolObject&& a, const MolObject& b);
+MolObject operator*(const MolObject& a, const MolObject& b);
+MolObject operator<(const MolObject& a, const MolObject& b);
+MolObject operator<=(const MolObject& a, const MolObject& b);
+MolObject operator==(const MolObject& a, const MolObject& b);
+
+// The operands of a binary operation where both may read input or throw. The clauses of a
+// braced initializer are evaluated left to right, unlike the arguments of an operator call, so
+// `MolOperands{a, b}.add()` does both in source order, as the VM does.
+struct MolOperands {
+    MolObject left;
+    MolObject right;
+
+    MolObject add() && { return std::move(left) + right; }
+    MolObject multiply() const { return left * right; }
+    MolObject less() const { return left < right; }
+    MolObject less_equal() const { return left <= right; }
+    MolObject equal() const { return left == right; }
+};
+
+// `target = target + suffix`, extending target's string buffer in place when it is the only
+// owner. Compiled `x = x + y` assignments use this, so building a string in a loop is linear.
+MolObject& mollang_append(MolObject& target, const MolObject& suffix);
+
+std::string mollang_concat(std::string_view a, std::string_view b);
+std::string mollang_repeat(std::string_view str, int count);
+
+// Helper functions
+// Sets up '스크럼' output: fully buffered, or flushed after every line when `line_buffered`.
+// Buffered output is also flushed before reads, at exit and on abnormal termination.
+void mollang_init_output(bool line_buffered);
+void mollang_flush_output();
+
+void mollang_print(const MolObject& obj);
+void mollang_print(int v);
+void mollang_print(std::string_view v);
+void mollang_print(bool v);
+
+MolObject mollang_input();
+
+// '몰몰' support. Iterations run on the runtime's worker threads, which share every global, so
+// functions a loop body calls check before each assignment that they are not running inside
+// a loop; '뭐먹' fails there as well.
+extern thread_local bool mollang_in_parallel;
+[[noreturn]] void mollang_shared_write_error();
+inline void mollang_check_shared_write() {
+    if (mollang_in_parallel) mollang_shared_write_error();
+}
+
+// The value a '합' ('+') or '곱' ('*') reduction starts from in every chunk of a loop, of the
+// same type as the variable it is folded into. The compiler rejects '곱' on a variable that
+// may hold a string, so reaching the string case here is a bug, reported as a type error.
+inline int mollang_reduction_identity(int, char op) { return op == '+' ? 0 : 1; }
+inline std::string mollang_reduction_identity(std::string_view, char op) {
+    if (op != '+') mollang_type_error("*");
+    return std::string();
+}
+inline bool mollang_reduction_identity(bool, char op) { mollang_type_error(op == '+' ? "+" : "*"); }
+inline MolObject mollang_reduction_identity(const MolObject& v, char op) {
+    if (v.is_int()) return MolObject(op == '+' ? 0 : 1);
+    if (v.is_string() && op == '+') return MolObject("");
+    mollang_type_error(op == '+' ? "+" : "*");
+}
+
+// Folds a chunk's result into the reduction variable.
+inline void mollang_reduce(int& target, int partial, char op) {
+    if (op == '+') {
+        target += partial;
+    } else {
+        target *= partial;
+    }
+}
+inline void mollang_reduce(std::string& target, const std::string& partial, char) { target += partial; }
+inline void mollang_reduce(bool&, bool, char) {} // unreachable: a bool has no identity
+inline void mollang_reduce(MolObject& target, const MolObject& partial, char op) {
+    if (op == '+') {
+        mollang_append(target, partial);
+    } else {
+        target = target * partial;
+    }
+}
+
+// Runs a '몰몰' loop over [begin, end). The range is cut into chunks, several per thread, that
+// idle threads steal from each other's queues; each chunk calls the body once with its own
+// subrange. '스크럼' output of a chunk is kept aside and written in chunk order afterwards, and
+// the error of the first failing chunk is rethrown after the output of the chunks before it,
+// so a loop prints what running its iterations in order would have. Loops nested inside a
+// running one, --profile builds (`serial`) and single-thread runs use one chunk on the
+// calling thread. $MOLLANG_THREADS sets the number of threads, by default one per core.
+class MolParallelLoop {
+public:
+    MolParallelLoop(int begin, int end, bool serial = false);
+
+    size_t chunks() const { return chunk_count; }
+
+    // body(size_t chunk, int first, int last) for every chunk, then returns.
+    template <typename Body>
+    void run(Body&& body) {
+        run_chunks([](void* context, size_t chunk, int first, int last) {
+            (*static_cast<std::remove_reference_t<Body>*>(context))(chunk, first, last);
+        }, &body);
+    }
+
+private:
+    int begin;
+    int end;
+    size_t chunk_count;
+
+    void run_chunks(void (*call)(void*, size_t, int, int), void* context);
+};
+
+// --profile support. A profiled program has one site per '몰', '입' and '캠프' and registers the
+// table with mollang_profile_init(); a flat profile is written when it exits normally.
+struct MolProfileSite {
+    const char* label; // "몰", "입" or the function name
+    int line;
+    int column;
+    std::uint64_t entries = 0;    // loops started, conditions tested, calls made
+    std::uint64_t iterations = 0; // loop iterations, branches taken
+    std::uint64_t cycles = 0;     // inclusive, including nested constructs and calls
+};
+
+// Time stamp counter ticks on x86, nanoseconds elsewhere.
+inline std::uint64_t mollang_cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Counts an entry into `site` and adds the time until the end of the scope.
+class MolProfileScope {
+public:
+    explicit MolProfileScope(MolProfileSite& site) : site(site), start(mollang_cycles()) { ++site.entries; }
+    ~MolProfileScope() { site.cycles += mollang_cycles() - start; }
+    MolProfileScope(const MolProfileScope&) = delete;
+    MolProfileScope& operator=(const MolProfileScope&) = delete;
+
+private:
+    MolProfileSite& site;
+    std::uint64_t start;
+};
+
+// The profile goes to $MOLLANG_PROFILE_OUT, or mollang_profile.txt in the working directory.
+void mollang_profile_init(MolProfileSite* sites, size_t count);
+
+#endif // MOLLANG_RUNTIME_HPP